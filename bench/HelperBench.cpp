@@ -0,0 +1,260 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmark for the DesktopFile string helpers. Each case runs one 
+ * helper over a set of lines shaped like those found in real desktop 
+ * entries, .directory and .menu files and command line options, and reports 
+ * the time and the number of heap allocations per line. Build it with 
+ * make bench and run ./mwmmenu-bench [rounds] */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <new>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/DesktopFile.h"
+
+static unsigned long allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+    allocations++;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    free(p);
+}
+
+enum Helper
+{
+    id = 0,
+    singleValue,
+    multiValue
+};
+
+struct BenchCase
+{   const char *name;
+    Helper helper;
+    char start;
+    char end;
+    std::vector<std::string> lines;
+};
+
+static const char *languages[] = {"ar", "be", "ca", "cs", "de", "el", "es",
+    "fi", "fr", "hu", "it", "ja", "ko", "nl", "pl", "pt_BR", "ru", "sv", "tr",
+    "uk", "zh_CN", "zh_TW"};
+static const unsigned int languageCount = 
+    sizeof(languages) / sizeof(languages[0]);
+
+//Localized comment lines, the bulk of most desktop entries
+static std::vector<std::string> commentLines()
+{
+    std::vector<std::string> lines;
+    for (unsigned int x = 0; x < languageCount; x++)
+    {
+        std::ostringstream line;
+        line << "Comment[" << languages[x] << "]=Browse, organise and edit "
+            "the files and folders stored on this computer and the network "
+            "locations it is connected to (" << x << ")";
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+//Long Exec lines with environment settings, options and field codes
+static std::vector<std::string> execLines()
+{
+    std::vector<std::string> lines;
+    for (unsigned int x = 0; x < 16; x++)
+    {
+        std::ostringstream line;
+        line << "Exec=env GDK_BACKEND=x11 MOZ_ENABLE_WAYLAND=0 "
+            "/opt/application-" << x << "/bin/application-launcher "
+            "--profile-directory=Default --enable-features=UseOzonePlatform "
+            "--class=Application" << x << " %U";
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+//Categories lines listing many categories
+static std::vector<std::string> categoryLines()
+{
+    std::vector<std::string> lines;
+    const char *categories[] = {"GTK", "GNOME", "Qt", "KDE", "Utility", 
+        "TextEditor", "Development", "IDE", "Graphics", "2DGraphics", 
+        "RasterGraphics", "AudioVideo", "Player", "Network", "WebBrowser"};
+    for (unsigned int x = 0; x < 16; x++)
+    {
+        std::string line = "Categories=";
+        for (unsigned int y = 0; y < 6 + x % 8; y++)
+            line += std::string(categories[(x + y) % 15]) + ";";
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+//Lines from .menu files, read through the GET_*_XML macros
+static std::vector<std::string> menuLines()
+{
+    std::vector<std::string> lines;
+    lines.push_back("        <Category>Development</Category>");
+    lines.push_back("        <Filename>org.gnome.gedit.desktop</Filename>");
+    lines.push_back("    <Directory>Development.directory</Directory>");
+    lines.push_back("    <Name>Programming</Name>");
+    lines.push_back("    <Include>");
+    lines.push_back("    </Include>");
+    return lines;
+}
+
+//Comma separated option values, read through GET_COMMA_VALUES
+static std::vector<std::string> optionLines()
+{
+    std::vector<std::string> lines;
+    lines.push_back("Firefox,Thunderbird,LibreOffice Writer,GIMP");
+    lines.push_back("GNOME,KDE,XFCE");
+    lines.push_back("Games,Education,Science");
+    return lines;
+}
+
+//Time a case and print a row of results
+static void runCase(const BenchCase& bench, unsigned int rounds)
+{
+    unsigned long sink = 0;
+    unsigned long lineCount = 0;
+    unsigned long startAllocations = allocations;
+    struct timespec startTime;
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (unsigned int x = 0; x < rounds; x++)
+    {
+        for (unsigned int y = 0; y < bench.lines.size(); y++)
+        {
+            switch (bench.helper)
+            {
+                case id:
+                    sink += DesktopFile::getID(bench.lines[y], bench.start, 
+                            bench.end).size();
+                    break;
+                case singleValue:
+                    sink += DesktopFile::getSingleValue(bench.lines[y], 
+                            bench.start, bench.end).size();
+                    break;
+                case multiValue:
+                    sink += DesktopFile::getMultiValue(bench.lines[y], 
+                            bench.end, bench.start).size();
+                    break;
+            }
+        }
+        lineCount += bench.lines.size();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    double ns = (endTime.tv_sec - startTime.tv_sec) * 1e9 + 
+        (endTime.tv_nsec - startTime.tv_nsec);
+    std::cout << std::left << std::setw(32) << bench.name << std::right 
+        << std::fixed << std::setprecision(1) << std::setw(10) 
+        << ns / lineCount << std::setw(14) 
+        << (double)(allocations - startAllocations) / lineCount;
+    //Printing the sink stops the compiler throwing the work away
+    std::cout << (sink == 0 ? " !" : "") << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int rounds = 20000;
+    if (argc > 1) rounds = atoi(argv[1]);
+    if (rounds == 0)
+    {
+        std::cerr << "Usage: mwmmenu-bench [rounds]" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchCase> cases;
+    BenchCase bench;
+
+    bench.start = '\0';
+    bench.end = '=';
+    bench.helper = id;
+    bench.name = "getID comment";
+    bench.lines = commentLines();
+    cases.push_back(bench);
+    bench.name = "getID exec";
+    bench.lines = execLines();
+    cases.push_back(bench);
+    bench.name = "getID categories";
+    bench.lines = categoryLines();
+    cases.push_back(bench);
+    bench.name = "getID menu (xml)";
+    bench.start = '<';
+    bench.end = '>';
+    bench.lines = menuLines();
+    cases.push_back(bench);
+
+    bench.helper = singleValue;
+    bench.start = '=';
+    bench.end = '\0';
+    bench.name = "getSingleValue comment";
+    bench.lines = commentLines();
+    cases.push_back(bench);
+    bench.name = "getSingleValue exec";
+    bench.lines = execLines();
+    cases.push_back(bench);
+    bench.name = "getSingleValue menu (xml)";
+    bench.start = '>';
+    bench.end = '<';
+    bench.lines = menuLines();
+    cases.push_back(bench);
+
+    //For getMultiValue, end holds the separator
+    bench.helper = multiValue;
+    bench.start = '=';
+    bench.end = ';';
+    bench.name = "getMultiValue categories";
+    bench.lines = categoryLines();
+    cases.push_back(bench);
+    bench.name = "getMultiValue options (comma)";
+    bench.start = '\0';
+    bench.end = ',';
+    bench.lines = optionLines();
+    cases.push_back(bench);
+
+    std::cout << std::left << std::setw(32) << "case" << std::right 
+        << std::setw(10) << "ns/line" << std::setw(14) << "allocs/line" 
+        << std::endl;
+    for (unsigned int x = 0; x < cases.size(); x++) runCase(cases[x], rounds);
+    return 0;
+}
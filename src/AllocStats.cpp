@@ -0,0 +1,150 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include "AllocStats.h"
+
+#ifdef MWMMENU_ALLOC_STATS
+
+//Each block starts with its size, padded to keep the alignment malloc gives
+#define ALLOC_HEADER 16
+
+static const char *phaseNames[NUM_ALLOC_PHASES] = {"startup", "scan", "icons",
+    "categories", "parse", "filter", "render"};
+
+/* The counters are updated atomically as menus can be written on several 
+ * threads. The phase is only changed by the main thread */
+static int currentPhase = phaseStartup;
+static unsigned long allocations[NUM_ALLOC_PHASES];
+static unsigned long allocatedBytes[NUM_ALLOC_PHASES];
+static unsigned long peakLiveBytes[NUM_ALLOC_PHASES];
+static unsigned long liveBytes = 0;
+static bool reportRegistered = false;
+
+static void *countedAlloc(std::size_t size)
+{
+    char *block = static_cast<char*>(malloc(size + ALLOC_HEADER));
+    if (block == NULL) return NULL;
+    *reinterpret_cast<std::size_t*>(block) = size;
+    int phase = __atomic_load_n(&currentPhase, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocations[phase], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocatedBytes[phase], size, __ATOMIC_RELAXED);
+    unsigned long live = __atomic_add_fetch(&liveBytes, size, __ATOMIC_RELAXED);
+    unsigned long peak = __atomic_load_n(&peakLiveBytes[phase], __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&peakLiveBytes[phase], 
+                &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    return block + ALLOC_HEADER;
+}
+
+static void countedFree(void *p)
+{
+    if (p == NULL) return;
+    char *block = static_cast<char*>(p) - ALLOC_HEADER;
+    __atomic_sub_fetch(&liveBytes, *reinterpret_cast<std::size_t*>(block), 
+            __ATOMIC_RELAXED);
+    free(block);
+}
+
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+    void *p = countedAlloc(size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+//The library can allocate with these and free with plain delete, so they 
+//must use the same header
+void *operator new(std::size_t size, const std::nothrow_t&) throw()
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) throw()
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void *p) throw()
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    countedFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) throw()
+{
+    countedFree(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) throw()
+{
+    countedFree(p);
+}
+
+/* Count the allocations from now on against the given phase. The peak of a 
+ * phase starts at what is already live when it starts. The report is 
+ * printed at exit */
+void AllocStats::phase(AllocPhase phase)
+{
+    if (!reportRegistered)
+    {
+        atexit(report);
+        reportRegistered = true;
+    }
+    unsigned long live = __atomic_load_n(&liveBytes, __ATOMIC_RELAXED);
+    if (live > peakLiveBytes[phase]) peakLiveBytes[phase] = live;
+    __atomic_store_n(&currentPhase, (int)phase, __ATOMIC_RELAXED);
+}
+
+/* Print the counts for each phase. stdio is used as it doesn't allocate, so 
+ * the report doesn't count itself */
+void AllocStats::report()
+{
+    fprintf(stderr, "mwmmenu: heap allocations by phase\n");
+    fprintf(stderr, "%-12s %12s %14s %14s\n", "phase", "allocations", 
+            "bytes", "peak live");
+    unsigned long totalAllocations = 0;
+    unsigned long totalBytes = 0;
+    unsigned long peak = 0;
+    for (int x = 0; x < NUM_ALLOC_PHASES; x++)
+    {
+        fprintf(stderr, "%-12s %12lu %14lu %14lu\n", phaseNames[x], 
+                allocations[x], allocatedBytes[x], peakLiveBytes[x]);
+        totalAllocations += allocations[x];
+        totalBytes += allocatedBytes[x];
+        if (peakLiveBytes[x] > peak) peak = peakLiveBytes[x];
+    }
+    fprintf(stderr, "%-12s %12lu %14lu %14lu\n", "total", totalAllocations, 
+            totalBytes, peak);
+}
+
+#endif
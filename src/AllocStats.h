@@ -0,0 +1,59 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ALLOC_STATS_H_
+#define _ALLOC_STATS_H_
+
+//The parts of a run that heap allocations are counted against
+enum AllocPhase
+{
+    phaseStartup = 0,
+    phaseScan,
+    phaseIcons,
+    phaseCategories,
+    phaseParse,
+    phaseFilter,
+    phaseRender
+};
+
+#define NUM_ALLOC_PHASES 7
+
+/* Allocation accounting, built into mwmmenu-alloc-stats by make alloc-stats.
+ * operator new and delete are replaced to count the allocations, bytes and 
+ * peak live bytes of each phase, which are printed to standard error at 
+ * exit. In the normal build ALLOC_PHASE does nothing */
+#ifdef MWMMENU_ALLOC_STATS
+
+class AllocStats
+{
+    public:
+        static void phase(AllocPhase phase);
+        static void report();
+};
+
+#define ALLOC_PHASE(X) AllocStats::phase(X)
+
+#else
+
+#define ALLOC_PHASE(X)
+
+#endif
+
+#endif
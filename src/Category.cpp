@@ -19,16 +19,22 @@
  */
 
 #include <algorithm>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <iomanip>
 #include "Category.h"
+#include "FileReader.h"
 
 int Category::registerCount = 0;
-std::vector<DesktopFile*> Category::incEntriesR = std::vector<DesktopFile*>();
+std::vector<unsigned int> Category::incEntriesR = std::vector<unsigned int>();
 std::vector<Category*> Category::incSubcatsR = std::vector<Category*>();
 
 //Constructor for custom categories
 Category::Category(const char *dirFile, const std::vector<std::string>& menuFiles, 
         bool useIcons, const std::vector<IconSpec>& iconpaths, 
-        const std::string& iconsXdgSize, bool iconsXdgOnly) :
+        const std::string& iconsXdgSize, bool iconsXdgOnly, 
+        const InputLimits& limits) :
     depth(0),
     nodisplay(false),
     dirFile(dirFile),
@@ -36,16 +42,15 @@ Category::Category(const char *dirFile, const std::vector<std::string>& menuFile
     iconpaths(iconpaths),
     iconsXdgSize(iconsXdgSize),
     iconsXdgOnly(iconsXdgOnly),
-    useIcons(useIcons)
+    useIcons(useIcons),
+    limits(limits)
 {   
-    dir_f.open(dirFile);
-    if (!dir_f);
-    else
+    std::vector<std::string> dir;
+    if (FileReader::readLines(dirFile, dir, limits.maxFileSize, limits.maxLine))
     { 
-        parseDir();
+        parseDir(dir);
         if (this->name != "Other") this->validNames.push_back(this->name);
         readMenufiles();
-        dir_f.close();
         if (useIcons) getCategoryIcon();
     }
 }
@@ -53,16 +58,18 @@ Category::Category(const char *dirFile, const std::vector<std::string>& menuFile
 //Constructor for subcategories
 Category::Category(std::vector<std::string> menuDef, const char *dirFile, 
         bool useIcons, const std::vector<IconSpec>& iconpaths, 
-        const std::string& iconsXdgSize, bool iconsXdgOnly, int depth) :
+        const std::string& iconsXdgSize, bool iconsXdgOnly, 
+        const InputLimits& limits, int depth) :
     depth(depth),
     nodisplay(false),
     dirFile(dirFile),
     iconpaths(iconpaths),
     iconsXdgSize(iconsXdgSize),
     iconsXdgOnly(iconsXdgOnly),
-    useIcons(useIcons)
+    useIcons(useIcons),
+    limits(limits)
 {
-    parseMenu(menuDef);
+    parseMenu(menuDef, true);
     if (this->name != "Other") this->validNames.push_back(this->name);
     if (useIcons) getCategoryIcon();
 }
@@ -83,18 +90,22 @@ Category::Category(const std::string& name, bool useIcons,
     if (useIcons) getCategoryIcon();
 }
 
-/* A function to parse a directory file to get get the category name and 
- * icon definition */
-void Category::parseDir()
-{   
-    std::string line;
+//A category owns its subcategories, including the pages made by paginate()
+Category::~Category()
+{
+    for (unsigned int x = 0; x < incCategories.size(); x++) 
+        delete incCategories[x];
+}
 
-    while (!dir_f.eof())
+/* A function to parse the lines of a directory file to get get the category 
+ * name and icon definition */
+void Category::parseDir(const std::vector<std::string>& dir)
+{   
+    for (unsigned int x = 0; x < dir.size(); x++)
     {
-        getline(dir_f, line);
-        std::string id = GET_ID_INI(line);
-        if (id == "Name") name = GET_VAL_INI(line);
-        if (id == "Icon") icon = GET_VAL_INI(line);
+        std::string id = GET_ID_INI(dir[x]);
+        if (id == "Name") name = GET_VAL_INI(dir[x]);
+        if (id == "Icon") icon = GET_VAL_INI(dir[x]);
     }
 }
 
@@ -106,112 +117,170 @@ void Category::readMenufiles()
     std::vector<std::string> menuVec;
     for (unsigned int x = 0; x < menuFiles.size(); x++)
     {
-        menu_f.open(menuFiles[x].c_str());
-        if (!menu_f) continue;
-        std::string line;
-        while (!menu_f.eof())
-        { 
-            getline(menu_f, line);
-            menuVec.push_back(line);
-        }
-        menu_f.close();
-        parseMenu(menuVec);
+        if (!FileReader::readLines(menuFiles[x], menuVec, limits.maxFileSize, 
+                    limits.maxLine))
+            continue;
+        parseMenu(splitTags(menuVec));
         menuVec.clear();
     }
 }
 
+/* Split the lines of a menu file so each starts with its own tag, e.g. 
+ * <Menu><Name>Sub</Name> becomes <Menu>, <Name>Sub and </Name>. The parser 
+ * looks at one tag per line, and menu files don't have to put them on 
+ * lines of their own */
+std::vector<std::string> Category::splitTags(const std::vector<std::string>& lines)
+{
+    std::vector<std::string> result;
+    for (unsigned int x = 0; x < lines.size(); x++)
+    {
+        const std::string& line = lines[x];
+        std::string::size_type start = line.find('<');
+        if (start == std::string::npos) continue;
+        while (start != std::string::npos)
+        {
+            std::string::size_type end = line.find('<', start + 1);
+            result.push_back(line.substr(start, end == std::string::npos ? 
+                        std::string::npos : end - start));
+            start = end;
+        }
+    }
+    return result;
+}
+
+/* Read a directory file named in a nested menu, which is looked for next to
+ * the directory file of the top level category, for the menu's name and 
+ * icon. A name given by the menu itself is kept */
+void Category::readNestedDir(const std::string& dirName)
+{
+    std::string path = dirFile.substr(0, dirFile.find_last_of('/') + 1) + dirName;
+    std::vector<std::string> dir;
+    if (!FileReader::readLines(path, dir, limits.maxFileSize, limits.maxLine)) 
+        return;
+    std::string menuName = name;
+    parseDir(dir);
+    if (menuName != "") name = menuName;
+}
+
 /* A function to parse an xdg menu files to get includes/excludes 
- * and submenus */
-void Category::parseMenu(const std::vector<std::string>& menu)
+ * and submenus. Tags are matched by the name GET_ID_XML gives, which is 
+ * without the angle brackets, e.g. Menu and /Menu. A top level category 
+ * takes what is in the menu whose Directory is its directory file. A 
+ * nested menu is given the lines inside its own Menu tags, and its own 
+ * Directory only gives its name and icon */
+void Category::parseMenu(const std::vector<std::string>& menu, bool nested)
 {   
-    std::string line;
-    std::string dirLine;
     std::vector<std::string> subMenu;
-    bool started = false;
+    bool started = nested;
     bool including = false;
-    bool menuStarted = false;
-    int menuOpenCnt = 0;
-    int menuCloseCnt = 0;
+    //How deeply the current line is nested in the file's menus, the level of
+    //the menu this category was found in and how deeply the current line is
+    //nested in a submenu being collected
+    int level = 0;
+    int startedLevel = 0;
+    int subLevel = 0;
     for (unsigned int x = 0; x < menu.size(); x++)
     {
-        line = menu[x];
+        const std::string& line = menu[x];
         std::string id = GET_ID_XML(line);
-        if (id == "<Directory>")
-        { 
-            std::string dir = GET_VAL_XML(line);
-            dirLine = line;
-            if (dir == dirFile.substr(dirFile.find_last_of("/") + 1, 
-                    dirFile.size() - dirFile.find_last_of("/") - 1))
-                started = true;
-            else
-                started = false;
+        if (subLevel > 0)
+        {
+            if (id == "Menu") subLevel++;
+            if (id == "/Menu") subLevel--;
+            if (subLevel > 0) subMenu.push_back(line);
+            else addNestedMenu(subMenu);
+            continue;
         }
-        if (id == "<Menu>" && started)
+        if (id == "Menu")
         {
-            menuStarted = true;
-            menuOpenCnt++;
+            if (started) 
+            {
+                subLevel = 1;
+                subMenu.clear();
+            }
+            else level++;
+            continue;
         }
-        if (menuStarted)
+        if (id == "/Menu")
         {
-            subMenu.push_back(line);
+            if (started && !nested && level == startedLevel) started = false;
+            level--;
+            continue;
         }
-        if (id == "</Menu>" && menuStarted)
+        if (id == "Directory")
         {
-            menuCloseCnt++;
-            if (menuOpenCnt == menuCloseCnt)
+            std::string dir = GET_VAL_XML(line);
+            if (nested) readNestedDir(dir);
+            else
             {
-                subMenu.erase(subMenu.begin());
-                subMenu.erase(subMenu.end());
-                subMenu.insert(subMenu.begin(), dirLine);
-                Category *c = new Category(subMenu, dirFile.c_str(), useIcons, iconpaths, 
-                        iconsXdgSize, iconsXdgOnly, depth + 1);
-                bool replaced = false;
-                std::vector<Category*> currentCats = this->getSubcats();
-                for (unsigned int y = 0; y < currentCats.size(); y++)
-                {
-                    Category *curCat = currentCats[y];
-                    if (c->name == curCat->name)
-                    {
-                        currentCats[y] = c;
-                        replaced = true;
-                        break;
-                    }
-                }
-                if (!replaced) incCategories.push_back(c);
-                subMenu.clear();
-                menuStarted = false;
-                menuOpenCnt = 0;
-                menuCloseCnt = 0;
+                started = dir == dirFile.substr(dirFile.find_last_of("/") + 1);
+                startedLevel = level;
             }
+            continue;
         }
-        if (id == "<Name>" && started && !menuStarted) this->name = GET_VAL_XML(line);
-        if (id == "<Include>" && started && !menuStarted) including = true;
-        if (id == "<Exclude>" && started && !menuStarted) including = false;
-        if (started && id == "<Filename>" && !menuStarted) 
+        if (!started) continue;
+        if (id == "Name") this->name = GET_VAL_XML(line);
+        if (id == "Include") including = true;
+        if (id == "Exclude") including = false;
+        if (id == "Filename") 
         {   
             if (including) incEntryFiles.push_back(GET_VAL_XML(line));
             else excEntryFiles.push_back(GET_VAL_XML(line));
         }
-        if (started && id == "<Category>" && !menuStarted) 
+        if (id == "Category") 
         {   
             if (including) validNames.push_back(GET_VAL_XML(line));
         }
     }
 }
 
-/* Return all DesktopFiles associated with this category */
-std::vector<DesktopFile*> Category::getEntries()
+/* Make a subcategory from the lines inside a nested menu, replacing an 
+ * earlier one of the same name. Menus nested too deeply and menus which 
+ * end up without a name are skipped with a message */
+void Category::addNestedMenu(const std::vector<std::string>& subMenu)
 {
-    sort(incEntries.begin(), incEntries.end(), myCompare<DesktopFile>);
+    //Deeply nested menus are dropped rather than recursed into
+    if (depth + 1 > (int)limits.maxMenuDepth)
+    {
+        std::cerr << "mwmmenu: skipping menus nested more than " << 
+            limits.maxMenuDepth << " levels deep for " << dirFile << 
+            std::endl;
+        return;
+    }
+    Category *c = new Category(subMenu, dirFile.c_str(), useIcons, iconpaths, 
+            iconsXdgSize, iconsXdgOnly, limits, depth + 1);
+    if (c->name == "")
+    {
+        std::cerr << "mwmmenu: skipping a menu without a name for " << 
+            dirFile << std::endl;
+        delete c;
+        return;
+    }
+    for (unsigned int y = 0; y < incCategories.size(); y++)
+    {
+        if (c->name == incCategories[y]->name)
+        {
+            delete incCategories[y];
+            incCategories[y] = c;
+            return;
+        }
+    }
+    incCategories.push_back(c);
+}
+
+/* Return the rows of all entries associated with this category */
+std::vector<unsigned int> Category::getEntries(const EntryTable& entries)
+{
+    sort(incEntries.begin(), incEntries.end(), EntryTable::NameCompare(&entries));
     return incEntries;
 }
 
-/* Return all DesktopFiles associated with this category plus all
+/* Return the rows of all entries associated with this category plus all
  * associate subcategories */
-std::vector<DesktopFile*> Category::getEntriesR()
+std::vector<unsigned int> Category::getEntriesR()
 {
     getEntriesR(this);
-    std::vector<DesktopFile*> result(Category::incEntriesR);
+    std::vector<unsigned int> result(Category::incEntriesR);
     Category::incEntriesR.clear();
     return result;
 }
@@ -260,14 +329,27 @@ std::vector<std::string> Category::getExcludes()
     return excEntryFiles;
 }
 
-/* Add a DesktopFile to the list of included entries if its specified category
+/* Give the category names this category and its subcategories match on ids
+ * in the entry table. This must be done before entries are added to the 
+ * table, as entries only keep the ids of categories which were interned */
+void Category::internNames(EntryTable& entries)
+{
+    validIds.clear();
+    for (unsigned int x = 0; x < validNames.size(); x++)
+        validIds.push_back(entries.internCategory(validNames[x]));
+    for (unsigned int x = 0; x < incCategories.size(); x++)
+        incCategories[x]->internNames(entries);
+}
+
+/* Add an entry to the list of included entries if its specified category
  * matches the category name or an included category name for the category or 
  * for any child subcategories. Return true to indicate the entry was included 
  * and false to indicate that it was not */
-bool Category::registerDF(DesktopFile *df, bool force)
+bool Category::registerEntry(const EntryTable& entries, unsigned int entry, 
+        bool force)
 {
     bool result = false;
-    registerDF(this, df, force);
+    registerEntry(this, entries, entry, force);
     if (registerCount > 0)
     {
         result = true;
@@ -276,40 +358,137 @@ bool Category::registerDF(DesktopFile *df, bool force)
     return result;
 }
 
-void Category::registerDF(Category *cat, DesktopFile *df, bool force)
+void Category::registerEntry(Category *cat, const EntryTable& entries, 
+        unsigned int entry, bool force)
 {
     if (force)
     {
-        cat->incEntries.push_back(df);
+        cat->incEntries.push_back(entry);
         registerCount++;
         return;
     }
-    for (unsigned int x = 0; x < cat->validNames.size(); x++)
+    const char *basename = entries.basename(entry);
+    for (unsigned int x = 0; x < cat->validIds.size(); x++)
     {
-        //Add to category if foundCategories contains the category name
-        if (find(df->foundCategories.begin(), df->foundCategories.end(), 
-                cat->validNames[x]) != df->foundCategories.end() &&
+        //Add to category if the entry has the category name
+        if (entries.hasCategory(entry, cat->validIds[x]) &&
                 find(cat->excEntryFiles.begin(), cat->excEntryFiles.end(), 
-                df->basename) == cat->excEntryFiles.end())
+                basename) == cat->excEntryFiles.end())
         {   
-            cat->incEntries.push_back(df);
+            cat->incEntries.push_back(entry);
             registerCount++;
         }
     }
     //Add to category if the category specifies a particular desktop file 
     //by filename
     if (find(cat->incEntryFiles.begin(), cat->incEntryFiles.end(), 
-            df->basename) != cat->incEntryFiles.end() && 
+            basename) != cat->incEntryFiles.end() && 
             find(cat->excEntryFiles.begin(), cat->excEntryFiles.end(), 
-            df->basename) == cat->excEntryFiles.end())
+            basename) == cat->excEntryFiles.end())
 
     {   
-        cat->incEntries.push_back(df);
+        cat->incEntries.push_back(entry);
         registerCount++;
     }
     //Call this function recursively on subcategories
     for (unsigned int x = 0; x < cat->incCategories.size(); x++)
-        registerDF(cat->incCategories[x], df);
+        registerEntry(cat->incCategories[x], entries, entry);
+}
+
+/* Add a subcategory to this category, which then owns it */
+void Category::registerSubcat(Category *cat)
+{
+    incCategories.push_back(cat);
+}
+
+/* If this category has more than maxItems visible entries, move them into 
+ * subcategories holding at most maxItems entries each. The subcategories are 
+ * named after the range of entry names they hold, e.g. Games (A-F), so their 
+ * names are unique and they sort in the same order as the entries. 
+ * Subcategories are split in the same way */
+void Category::paginate(const EntryTable& entries, unsigned int maxItems)
+{
+    for (unsigned int x = 0; x < incCategories.size(); x++)
+        incCategories[x]->paginate(entries, maxItems);
+    if (maxItems == 0) return;
+    std::vector<unsigned int> visible;
+    std::vector<unsigned int> sorted = getEntries(entries);
+    for (unsigned int x = 0; x < sorted.size(); x++)
+        if (!entries.nodisplay(sorted[x])) visible.push_back(sorted[x]);
+    if (visible.size() <= maxItems) return;
+
+    //Spread the entries evenly over as few pages as possible
+    unsigned int pages = (visible.size() + maxItems - 1) / maxItems;
+    unsigned int perPage = (visible.size() + pages - 1) / pages;
+    std::vector<unsigned int> firsts;
+    std::vector<unsigned int> lasts;
+    for (unsigned int x = 0; x < visible.size(); x += perPage)
+    {
+        unsigned int end = std::min(x + perPage, (unsigned int)visible.size());
+        firsts.push_back(visible[x]);
+        lasts.push_back(visible[end - 1]);
+    }
+    std::vector<std::string> labels = rangeLabels(entries, firsts, lasts);
+
+    std::vector<IconSpec> noIcons;
+    incEntries.clear();
+    for (unsigned int x = 0; x < labels.size(); x++)
+    {
+        Category *c = new Category(name + " (" + labels[x] + ")", false, 
+                noIcons, iconsXdgSize, iconsXdgOnly);
+        c->icon = icon;
+        c->depth = depth + 1;
+        unsigned int end = std::min((x + 1) * perPage, (unsigned int)visible.size());
+        for (unsigned int y = x * perPage; y < end; y++)
+            c->incEntries.push_back(visible[y]);
+        incCategories.push_back(c);
+    }
+}
+
+//Return the first length characters of a UTF-8 string. Continuation bytes,
+//of the form 10xxxxxx, never start a character, so they are never cut off
+static std::string leadingChars(const char *str, unsigned int length)
+{
+    unsigned int end = 0;
+    for (unsigned int chars = 0; str[end] != '\0'; end++)
+    {
+        if (((unsigned char)str[end] & 0xc0) == 0x80) continue;
+        if (chars++ == length) break;
+    }
+    return std::string(str, end);
+}
+
+/* Label each page with the start of the names of its first and last entries,
+ * using the fewest characters that give every page a different label */
+std::vector<std::string> Category::rangeLabels(const EntryTable& entries,
+        const std::vector<unsigned int>& firsts, 
+        const std::vector<unsigned int>& lasts)
+{
+    std::vector<std::string> labels;
+    for (unsigned int length = 1; length <= 64; length++)
+    {
+        labels.clear();
+        std::set<std::string> seen;
+        for (unsigned int x = 0; x < firsts.size(); x++)
+        {
+            std::string label = leadingChars(entries.name(firsts[x]), length) 
+                + "-" + leadingChars(entries.name(lasts[x]), length);
+            std::string lower = label;
+            for (unsigned int y = 0; y < lower.size(); y++) 
+                lower[y] = tolower((unsigned char)lower[y]);
+            seen.insert(lower);
+            labels.push_back(label);
+        }
+        if (seen.size() == labels.size()) return labels;
+    }
+    //Pages of entries with the same names, so just number them
+    for (unsigned int x = 0; x < labels.size(); x++)
+    {
+        std::ostringstream label;
+        label << labels[x] << " " << std::setw(3) << std::setfill('0') << x + 1;
+        labels[x] = label.str();
+    }
+    return labels;
 }
 
 /* Try to set a path to an icon. If the category is custom, we might already
@@ -356,7 +535,8 @@ void Category::getCategoryIcon()
     /* The main search loop. Here we try to match the category name against 
      * icon paths, checking that the word 'categories' appears somewhere 
      * in the path, as well as a basic check for size */
-    iconDef.at(0) = tolower(iconDef.at(0));
+    if (iconDef == "") return;
+    iconDef.at(0) = tolower((unsigned char)iconDef.at(0));
     for (unsigned int x = 0; x < iconpaths.size(); x++)
     {  
         if (iconpaths[x].path.find(nameGuard) != std::string::npos && 
@@ -22,6 +22,8 @@
 #define _CATEGORY_H_
 
 #include "DesktopFile.h"
+#include "EntryTable.h"
+#include "RunConfig.h"
 
 #define GET_ID_INI(X) DesktopFile::getID(X)
 #define GET_ID_XML(X) DesktopFile::getID(X, '<', '>')
@@ -33,54 +35,75 @@ class Category
     public:
         Category(const char *dirFile, const std::vector<std::string>& menuFiles, 
                 bool useIcons, const std::vector<IconSpec>& iconpaths, 
-                const std::string& iconsXdgSize, bool iconsXdgOnly);
+                const std::string& iconsXdgSize, bool iconsXdgOnly, 
+                const InputLimits& limits);
         Category(std::vector<std::string> menuDef, const char *dirFile,
                 bool useIcons, const std::vector<IconSpec>& iconpaths, 
-                const std::string& iconsXdgSize, bool iconsXdgOnly, int depth);
+                const std::string& iconsXdgSize, bool iconsXdgOnly, 
+                const InputLimits& limits, int depth);
         Category(const std::string& name, bool useIcons, 
                 const std::vector<IconSpec>& iconpaths, const std::string& iconsXdgSize, 
                 bool iconsXdgOnly);
+        ~Category();
         
         std::string name;
         std::string icon;
         int depth;
         bool nodisplay;
 
-        std::vector<DesktopFile*> getEntries();
-        std::vector<DesktopFile*> getEntriesR();
+        std::vector<unsigned int> getEntries(const EntryTable& entries);
+        std::vector<unsigned int> getEntriesR();
         std::vector<Category*> getSubcats();
         std::vector<Category*> getSubcatsR();
         std::vector<std::string> getIncludes();
         std::vector<std::string> getExcludes();
 
-        bool registerDF(DesktopFile *df, bool force = false);
+        void internNames(EntryTable& entries);
+        bool registerEntry(const EntryTable& entries, unsigned int entry, 
+                bool force = false);
+        void registerSubcat(Category *cat);
+        void paginate(const EntryTable& entries, unsigned int maxItems);
 
     private:
         std::string dirFile;
         std::vector<std::string> menuFiles;
-        std::ifstream dir_f;
-        std::ifstream menu_f;
         std::vector<std::string> validNames;
+        std::vector<uint16_t> validIds;
         std::vector<IconSpec> iconpaths;
         std::string iconsXdgSize;
         bool iconsXdgOnly;
         bool useIcons;
-        std::vector<DesktopFile*> incEntries;
+        InputLimits limits;
+        std::vector<unsigned int> incEntries;
         std::vector<Category*> incCategories;
         std::vector<std::string> incEntryFiles;
         std::vector<std::string> excEntryFiles;
 
         static int registerCount;
-        static std::vector<DesktopFile*> incEntriesR;
+        static std::vector<unsigned int> incEntriesR;
         static std::vector<Category*> incSubcatsR;
 
-        void registerDF(Category *cat, DesktopFile *df, bool force = false);
+        void registerEntry(Category *cat, const EntryTable& entries, 
+                unsigned int entry, bool force = false);
         void getEntriesR(Category *cat);
         void getSubcatsR(Category *cat);
 
+        //Subcategories are owned by their category, so it can't be copied
+        Category(const Category&);
+        Category& operator=(const Category&);
+
+        static std::vector<std::string> rangeLabels(const EntryTable& entries,
+                const std::vector<unsigned int>& firsts, 
+                const std::vector<unsigned int>& lasts);
+
         void readMenufiles();
-        void parseDir();
-        void parseMenu(const std::vector<std::string>& menu);
+        void parseDir(const std::vector<std::string>& dir);
+        void parseMenu(const std::vector<std::string>& menu, 
+                bool nested = false);
+        void readNestedDir(const std::string& dirName);
+        void addNestedMenu(const std::vector<std::string>& subMenu);
+        static std::vector<std::string> splitTags(
+                const std::vector<std::string>& lines);
         void getCategoryIcon();
 };
 
@@ -0,0 +1,92 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CategoryTree.h"
+#include "Category.h"
+
+CategoryTree::CategoryTree(const std::vector<Category*>& cats, 
+        const EntryTable& entries)
+{
+    for (unsigned int x = 0; x < cats.size(); x++)
+        addNode(cats[x], NO_CATEGORY_NODE, entries);
+    memberStarts.push_back(members.size());
+    for (unsigned int x = 0; x < size(); x++)
+        if (!(flags[x] & CATEGORY_NODISPLAY) && hasVisibleEntries(x))
+            flags[x] |= CATEGORY_VISIBLE;
+}
+
+/* Add a category and then its subcategories, in the order they are written. 
+ * Only entries which are displayed become members */
+void CategoryTree::addNode(Category *cat, uint32_t parent, 
+        const EntryTable& entries)
+{
+    uint32_t node = size();
+    names.push_back(cat->name);
+    icons.push_back(cat->icon);
+    parents.push_back(parent);
+    subtreeSizes.push_back(1);
+    memberStarts.push_back(members.size());
+    depths.push_back(cat->depth);
+    flags.push_back(cat->nodisplay ? CATEGORY_NODISPLAY : 0);
+
+    std::vector<unsigned int> rows = cat->getEntries(entries);
+    for (unsigned int x = 0; x < rows.size(); x++)
+        if (!entries.nodisplay(rows[x])) members.push_back(rows[x]);
+
+    std::vector<Category*> subCats = cat->getSubcats();
+    for (unsigned int x = 0; x < subCats.size(); x++)
+        addNode(subCats[x], node, entries);
+    subtreeSizes[node] = size() - node;
+}
+
+/* Return true if any displayed node in the subtree has a visible entry */
+bool CategoryTree::hasVisibleEntries(unsigned int node) const
+{
+    for (unsigned int x = node; x < node + subtreeSizes[node]; x++)
+        if (!(flags[x] & CATEGORY_NODISPLAY) && numMembers(x) > 0) return true;
+    return false;
+}
+
+unsigned int CategoryTree::nextSibling(unsigned int node) const
+{
+    unsigned int next = node + subtreeSizes[node];
+    if (parents[node] == NO_CATEGORY_NODE)
+        return next < size() ? next : NO_CATEGORY_NODE;
+    if (next < parents[node] + subtreeSizes[parents[node]]) return next;
+    return NO_CATEGORY_NODE;
+}
+
+/* Return the number of visible children of a node */
+unsigned int CategoryTree::numChildren(unsigned int node) const
+{
+    unsigned int count = 0;
+    for (unsigned int x = firstChild(node); x != NO_CATEGORY_NODE; x = nextSibling(x))
+        if (visible(x)) count++;
+    return count;
+}
+
+/* Return the visible top level nodes */
+std::vector<unsigned int> CategoryTree::roots() const
+{
+    std::vector<unsigned int> result;
+    for (unsigned int x = 0; x < size(); x += subtreeSizes[x])
+        if (visible(x)) result.push_back(x);
+    return result;
+}
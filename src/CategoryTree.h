@@ -0,0 +1,86 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CATEGORY_TREE_H_
+#define _CATEGORY_TREE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class Category;
+class EntryTable;
+
+//Node flags
+#define CATEGORY_NODISPLAY 0x1
+#define CATEGORY_VISIBLE 0x2
+
+#define NO_CATEGORY_NODE 0xffffffff
+
+/* The categories to be written, flattened in pre-order into columns. A node 
+ * is identified by its index. Its children start at the next index and its 
+ * subtree covers subtreeSize nodes, so walking a subtree is a scan over a 
+ * range of indices. The visible entries of each node are kept sorted by name 
+ * in one shared member array, and each node holds a contiguous range of it. 
+ * The tree is built once after filtering and pagination and does not change 
+ * afterwards */
+class CategoryTree
+{
+    public:
+        CategoryTree(const std::vector<Category*>& cats, const EntryTable& entries);
+
+        unsigned int size() const { return names.size(); }
+
+        const std::string& name(unsigned int node) const { return names[node]; }
+        const std::string& icon(unsigned int node) const { return icons[node]; }
+        int depth(unsigned int node) const { return depths[node]; }
+        bool visible(unsigned int node) const 
+            { return flags[node] & CATEGORY_VISIBLE; }
+
+        unsigned int parent(unsigned int node) const { return parents[node]; }
+        unsigned int firstChild(unsigned int node) const
+            { return subtreeSizes[node] > 1 ? node + 1 : NO_CATEGORY_NODE; }
+        unsigned int nextSibling(unsigned int node) const;
+        unsigned int numChildren(unsigned int node) const;
+
+        std::vector<unsigned int> roots() const;
+
+        std::vector<unsigned int>::const_iterator membersBegin(unsigned int node) const
+            { return members.begin() + memberStarts[node]; }
+        std::vector<unsigned int>::const_iterator membersEnd(unsigned int node) const
+            { return members.begin() + memberStarts[node + 1]; }
+        unsigned int numMembers(unsigned int node) const
+            { return memberStarts[node + 1] - memberStarts[node]; }
+
+    private:
+        std::vector<std::string> names;
+        std::vector<std::string> icons;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> subtreeSizes;
+        std::vector<uint32_t> memberStarts;
+        std::vector<uint16_t> depths;
+        std::vector<uint8_t> flags;
+        std::vector<unsigned int> members;
+
+        void addNode(Category *cat, uint32_t parent, const EntryTable& entries);
+        bool hasVisibleEntries(unsigned int node) const;
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <boost/filesystem.hpp>
+#include "Deadline.h"
+
+//Environment variables which change the menu produced for the same options
+static const char *outputVariables[] = {"HOME", "PATH", "XDG_DATA_HOME", 
+    "XDG_DATA_DIRS", "XDG_CONFIG_HOME", "XDG_CONFIG_DIRS"};
+
+//32 bit FNV-1a
+static void hashBytes(uint32_t& hash, const char *data, size_t size)
+{
+    for (size_t x = 0; x < size; x++)
+    {
+        hash ^= (unsigned char)data[x];
+        hash *= 16777619;
+    }
+}
+
+/* Return where the output for a set of options is kept. This lives next to 
+ * the parse cache and is named after a hash of the options, the working 
+ * directory and the environment variables which affect the menu */
+std::string Deadline::outputPath(const std::string& cacheFile, 
+        const std::vector<std::string>& args)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned int x = 1; x < args.size(); x++)
+        hashBytes(hash, args[x].c_str(), args[x].size() + 1);
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) != NULL) hashBytes(hash, cwd, strlen(cwd) + 1);
+    for (unsigned int x = 0; x < sizeof(outputVariables) / sizeof(char*); x++)
+    {
+        const char *value = getenv(outputVariables[x]);
+        if (value != NULL) hashBytes(hash, value, strlen(value));
+        hashBytes(hash, "", 1);
+    }
+    std::ostringstream name;
+    name << "menu-" << std::hex << std::setw(8) << std::setfill('0') << hash;
+    return (boost::filesystem::path(cacheFile).parent_path() / name.str()).string();
+}
+
+/* Copy a file to a file descriptor. Return COPY_MISSING if it can't be 
+ * opened and COPY_FAILED if it can't all be read or written, in which case 
+ * part of it may have been written already */
+int Deadline::copyFile(const std::string& path, int fd)
+{
+    int in = open(path.c_str(), O_RDONLY);
+    if (in < 0) return COPY_MISSING;
+    char buf[8192];
+    ssize_t count;
+    while ((count = read(in, buf, sizeof(buf))) != 0)
+    {
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+        ssize_t written = 0;
+        while (written < count)
+        {
+            ssize_t done = write(fd, buf + written, count - written);
+            if (done < 0 && errno == EINTR) continue;
+            if (done <= 0) 
+            {
+                close(in);
+                return COPY_FAILED;
+            }
+            written += done;
+        }
+    }
+    close(in);
+    return count == 0 ? COPY_DONE : COPY_FAILED;
+}
+
+/* Run in the child, which is the leader of a new session so it outlives us
+ * and isn't killed with our process group. Run mwmmenu without the deadline,
+ * with its output going to a temporary file, and keep the output if it 
+ * succeeds. Its errors go to errorFile */
+void Deadline::refresh(int deadlineMs, const std::string& outputFile, 
+        const std::string& errorFile, const std::vector<std::string>& args)
+{
+    setsid();
+    //Let go of the caller's terminal and pipes straight away, so a reader of
+    //our parent's output sees the end of it without waiting for the refresh
+    int null = open("/dev/null", O_RDWR);
+    if (null < 0) _exit(1);
+    dup2(null, 0);
+    dup2(null, 1);
+    dup2(null, 2);
+    if (null > 2) close(null);
+
+    std::ostringstream tmpPath;
+    tmpPath << outputFile << "." << getpid() << ".tmp";
+    int out = open(tmpPath.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int err = open(errorFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0 || err < 0) _exit(1);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(out, 1);
+        dup2(err, 2);
+        std::vector<char*> argv;
+        for (unsigned int x = 0; x < args.size(); x++) 
+            argv.push_back((char*)args[x].c_str());
+        argv.push_back(NULL);
+        std::ostringstream deadline;
+        deadline << deadlineMs;
+        setenv(DEADLINE_VARIABLE, deadline.str().c_str(), 1);
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+    close(out);
+    close(err);
+    int status = 1;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) status = 1;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+            rename(tmpPath.str().c_str(), outputFile.c_str()) == 0)
+        _exit(0);
+    unlink(tmpPath.str().c_str());
+    _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
+
+/* Generate the menu, waiting at most deadlineMs for it. args is the command
+ * line without the deadline option. If the menu isn't ready in time but an 
+ * earlier one is kept, write that and leave the menu to finish in the 
+ * background. Otherwise wait for it. Return the exit status */
+int Deadline::run(int deadlineMs, const std::string& outputFile, 
+        const std::vector<std::string>& args)
+{
+    try
+    {
+        boost::filesystem::create_directories(
+                boost::filesystem::path(outputFile).parent_path());
+    }
+    catch (boost::filesystem::filesystem_error&)
+    {
+    }
+    std::ostringstream errorPath;
+    errorPath << outputFile << "." << getpid() << ".err";
+    std::string errorFile = errorPath.str();
+
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid == 0) refresh(deadlineMs, outputFile, errorFile, args);
+
+    int status = 0;
+    bool finished = false;
+    struct timespec poll = {0, 5000000};
+    for (int waited = 0; waited < deadlineMs; waited += 5)
+    {
+        if (waitpid(pid, &status, WNOHANG) == pid)
+        {
+            finished = true;
+            break;
+        }
+        nanosleep(&poll, NULL);
+    }
+    if (!finished)
+    {
+        //Out of time. Anything kept from an earlier run will do, but if it
+        //can't all be written the menu is incomplete
+        int copied = copyFile(outputFile, 1);
+        if (copied != COPY_MISSING)
+        {
+            unlink(errorFile.c_str());
+            if (copied == COPY_DONE) return 0;
+            std::cerr << "mwmmenu: cannot write the kept menu" << std::endl;
+            return 1;
+        }
+        if (waitpid(pid, &status, 0) != pid) 
+        {
+            unlink(errorFile.c_str());
+            return 1;
+        }
+    }
+    copyFile(errorFile, 2);
+    unlink(errorFile.c_str());
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) 
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    if (copyFile(outputFile, 1) == COPY_DONE) return 0;
+    std::cerr << "mwmmenu: cannot write the menu" << std::endl;
+    return 1;
+}
@@ -0,0 +1,56 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DEADLINE_H_
+#define _DEADLINE_H_
+
+#include <string>
+#include <vector>
+
+/* Runs mwmmenu with a deadline. The menu is generated by a copy of mwmmenu 
+ * running in its own session, whose output is kept in the cache directory. 
+ * If it doesn't finish in time, the output kept from the last run with the 
+ * same options is written instead and the copy carries on in the background,
+ * so the next run finds a fresh menu and a warm parse cache */
+//Set for the copy of mwmmenu making the menu, so lazy pipe menus it writes
+//can be given the same deadline
+#define DEADLINE_VARIABLE "MWMMENU_DEADLINE"
+
+//Results of copying a kept file out
+#define COPY_DONE 0
+#define COPY_MISSING 1
+#define COPY_FAILED 2
+
+class Deadline
+{
+    public:
+        static int run(int deadlineMs, const std::string& outputFile, 
+                const std::vector<std::string>& args);
+        static std::string outputPath(const std::string& cacheFile, 
+                const std::vector<std::string>& args);
+
+    private:
+        static void refresh(int deadlineMs, const std::string& outputFile, 
+                const std::string& errorFile, 
+                const std::vector<std::string>& args);
+        static int copyFile(const std::string& path, int fd);
+};
+
+#endif
@@ -21,110 +21,310 @@
 #include <algorithm>
 #include <set>
 #include <string.h>
+#include <boost/unordered_set.hpp>
 #include "DesktopFile.h"
 #include "Category.h"
+#include "ParseCache.h"
+#include "ExecIndex.h"
+#include "EntryTable.h"
+#include "RunConfig.h"
+#include "FileReader.h"
 
-DesktopFile::DesktopFile(const char *filename, std::vector<std::string> showFromDesktops,
-        bool useIcons, const std::vector<IconSpec>& iconpaths, 
-        std::vector<Category*>& cats, const std::string& iconsXdgSize, bool iconsXdgOnly, 
-        const std::string& term) :
+DesktopFile::DesktopFile(const std::string& filename) :
     filename(filename),
-    basename(this->filename.substr(this->filename.find_last_of("/") + 1, 
-            this->filename.size() - this->filename.find_last_of("/") - 1)),
     nodisplay(false),
-    terminal(false)
+    terminal(false),
+    hidden(false)
 {   
-    dfile.open(filename);
-    if (!dfile);
-    else
-    {
-        populate(showFromDesktops, useIcons, iconpaths, cats, iconsXdgSize, 
-                iconsXdgOnly, term);
-        dfile.close();
-    }
 }
 
-/* This function fetches the required values (Name, Exec, Categories, 
- * NoDisplay etc) and then assigns the results to the appropriate instance 
- * variables or passes the results to the appropriate function */
-void DesktopFile::populate(const std::vector<std::string>& showFromDesktops, 
-        bool useIcons, const std::vector<IconSpec>& iconpaths, 
-        std::vector<Category*>& cats, const std::string& iconsXdgSize, bool iconsXdgOnly, 
-        const std::string& term)
-{  
-    std::string line;
-    std::string iconDef;
-    std::vector<std::string> onlyShowInDesktops;
-    bool started = false;
-
-    while (!dfile.eof())
-    {   
-        getline(dfile, line);
-        if (line.size() == 0) continue;
-        std::string id = getID(line);
-        /* .desktop files can contain more than just desktop entries. On getting
-         * the id [Desktop Entry] we know we've started looking at an entry */
-        if (id == "[Desktop Entry]")
+/* Read the desktop files at the given paths and return them in the same 
+ * order. If the values in a file are cached and the file hasn't changed, we
+ * needn't read it. The rest are read together by a FileReader and each one 
+ * is parsed as soon as it has been read. Files over the size or line length 
+ * limits are left empty, so they aren't shown, and aren't cached */
+std::vector<DesktopFile*> DesktopFile::readAll(const std::vector<std::string>& paths,
+        ParseCache *cache, bool useUring, const InputLimits& limits)
+{
+    std::vector<DesktopFile*> files;
+    std::vector<std::string> unread;
+    std::vector<unsigned int> unreadFiles;
+    for (unsigned int x = 0; x < paths.size(); x++)
+    {
+        files.push_back(new DesktopFile(paths[x]));
+        if (cache == NULL || !cache->fetch(files[x]))
         {
-            started = true;
-            continue;
+            unread.push_back(paths[x]);
+            unreadFiles.push_back(x);
         }
-        /* If we get another line beginning with [, it probably means we've 
-         * found a desktop action as opposed to a desktop entry. We should 
-         * break here to avoid the entry data being overwritten with 
-         * action data */
-        if (id[0] == '[' && started == true) break;
-        if (id == "Name")
-        {
-            name = getSingleValue(line);
-            continue;
-        }
-        if (id == "Exec")
+    }
+
+    FileReader reader(unread, useUring, limits.maxFileSize);
+    unsigned int index;
+    std::vector<char> data;
+    bool readable;
+    while (reader.next(index, data, readable))
+    {
+        if (!readable) continue;
+        DesktopFile *df = files[unreadFiles[index]];
+        if (data.size() > limits.maxFileSize)
         {
-            exec = getSingleValue(line);
+            FileReader::reportSkipped(df->filename, "larger than", 
+                    limits.maxFileSize);
             continue;
         }
-        if (id == "Categories")
+        if (!df->populate(data, limits.maxLine))
         {
-            foundCategories = getMultiValue(line);
+            FileReader::reportSkipped(df->filename, "has a line longer than", 
+                    limits.maxLine);
+            files[unreadFiles[index]] = new DesktopFile(df->filename);
+            delete df;
             continue;
         }
-        if (id == "NoDisplay")
+        if (cache != NULL) cache->store(df);
+    }
+    return files;
+}
+
+/* Hide desktop files whose TryExec program is missing, as they must be 
+ * treated as if they don't exist. If asked, do the same for files whose 
+ * Exec program is missing. This is done before dedupe(), so a copy which 
+ * can't be run doesn't stand in for one which can */
+void DesktopFile::hideUnavailable(std::vector<DesktopFile*>& files,
+        const RunConfig& config, ExecIndex *execIndex)
+{
+    for (unsigned int x = 0; x < files.size(); x++)
+    {
+        DesktopFile *df = files[x];
+        if (df->hidden || df->name == "" || df->exec == "") continue;
+        if ((df->tryExec != "" && !execIndex->available(df->tryExec)) ||
+                (config.checkExec && 
+                 !execIndex->available(ExecIndex::getProgram(df->exec))))
+            df->hidden = true;
+    }
+}
+
+/* Drop desktop files which are copies of an earlier file under another name,
+ * such as org.mozilla.firefox.desktop and firefox.desktop. Copies have the 
+ * same Name, Exec and Icon, ignoring case and spacing in the name, spacing in
+ * the command and the directory and extension of the icon. The files are in 
+ * order of precedence, so the first copy is kept. Files which are hidden or 
+ * only shown in some desktops are left alone, so they can't stand in for a 
+ * copy which would be shown */
+void DesktopFile::dedupe(std::vector<DesktopFile*>& files)
+{
+    boost::unordered_set<std::string> seen;
+    unsigned int kept = 0;
+    for (unsigned int x = 0; x < files.size(); x++)
+    {
+        DesktopFile *df = files[x];
+        if (df->name != "" && df->exec != "" && !df->hidden && !df->nodisplay &&
+                df->onlyShowInDesktops.empty())
         {
-            std::string value = getSingleValue(line);
-            if (value == "True" || value == "true")
-                nodisplay = true;
-            continue;
+            std::string icon = df->iconDef.substr(df->iconDef.find_last_of('/') + 1);
+            std::string::size_type dot = icon.find_last_of('.');
+            if (dot != std::string::npos && (icon.substr(dot) == ".png" || 
+                    icon.substr(dot) == ".svg" || icon.substr(dot) == ".xpm"))
+                icon.erase(dot);
+            std::string key = normalize(df->name, true) + '\0' + 
+                normalize(df->exec, false) + '\0' + icon;
+            if (!seen.insert(key).second)
+            {
+                delete df;
+                continue;
+            }
         }
-        if (id == "OnlyShowIn")
+        files[kept++] = df;
+    }
+    files.resize(kept);
+}
+
+/* Return a value with runs of spaces and tabs made single spaces and those at
+ * either end removed, optionally in lower case */
+std::string DesktopFile::normalize(const std::string& value, bool lowerCase)
+{
+    std::string result;
+    result.reserve(value.size());
+    bool space = false;
+    for (unsigned int x = 0; x < value.size(); x++)
+    {
+        char c = value[x];
+        if (c == ' ' || c == '\t')
         {
-            onlyShowInDesktops = getMultiValue(line);
+            space = !result.empty();
             continue;
         }
-        if (id == "Icon")
+        if (space) result += ' ';
+        space = false;
+        result += lowerCase ? (char)tolower(c) : c;
+    }
+    return result;
+}
+
+//The keys populate() wants. Each is told apart from the others by its length
+//and first character
+enum EntryKey
+{
+    keyNone = 0,
+    keyName,
+    keyExec,
+    keyIcon,
+    keyHidden,
+    keyTryExec,
+    keyTerminal,
+    keyNoDisplay,
+    keyCategories,
+    keyOnlyShowIn
+};
+
+/* Work out which key a line has from the length of the key and its first 
+ * character, then check the rest of it. Most lines in real files are 
+ * localized keys such as Name[de] or Comment[fr], which are turned away 
+ * without looking at more than that */
+static EntryKey matchKey(const char *key, size_t length)
+{
+    const char *want;
+    EntryKey result;
+    switch (length * 128 + (unsigned char)key[0])
+    {
+        case 4 * 128 + 'N': want = "Name"; result = keyName; break;
+        case 4 * 128 + 'E': want = "Exec"; result = keyExec; break;
+        case 4 * 128 + 'I': want = "Icon"; result = keyIcon; break;
+        case 6 * 128 + 'H': want = "Hidden"; result = keyHidden; break;
+        case 7 * 128 + 'T': want = "TryExec"; result = keyTryExec; break;
+        case 8 * 128 + 'T': want = "Terminal"; result = keyTerminal; break;
+        case 9 * 128 + 'N': want = "NoDisplay"; result = keyNoDisplay; break;
+        case 10 * 128 + 'C': want = "Categories"; result = keyCategories; break;
+        case 10 * 128 + 'O': want = "OnlyShowIn"; result = keyOnlyShowIn; break;
+        default: return keyNone;
+    }
+    if (memcmp(key + 1, want + 1, length - 1) != 0) return keyNone;
+    return result;
+}
+
+/* This function fetches the required values (Name, Exec, Categories, 
+ * NoDisplay etc) and assigns the results to the appropriate instance 
+ * variables. Lines are found with memchr and only the lines with a wanted 
+ * key are copied out of the buffer. Returns false if a line is longer than 
+ * maxLine, in which case the file should be skipped */
+bool DesktopFile::populate(const std::vector<char>& data, unsigned int maxLine)
+{  
+    if (data.empty()) return true;
+    const char *pos = &data[0];
+    const char *end = pos + data.size();
+    bool started = false;
+
+    while (pos < end)
+    {   
+        const char *lineEnd = (const char*)memchr(pos, '\n', end - pos);
+        if (lineEnd == NULL) lineEnd = end;
+        const char *lineStart = pos;
+        pos = lineEnd + 1;
+        if ((size_t)(lineEnd - lineStart) > maxLine) return false;
+        if (lineStart == lineEnd) continue;
+        const char *equals = (const char*)memchr(lineStart, '=', 
+                lineEnd - lineStart);
+        size_t keyLength = (equals == NULL ? lineEnd : equals) - lineStart;
+
+        /* .desktop files can contain more than just desktop entries. On getting
+         * the line [Desktop Entry] we know we've started looking at an entry */
+        if (lineStart[0] == '[')
         {
-            iconDef = getSingleValue(line);
+            if (keyLength == 15 && memcmp(lineStart, "[Desktop Entry]", 15) == 0)
+            {
+                started = true;
+                continue;
+            }
+            /* If we get another line beginning with [, it probably means 
+             * we've found a desktop action as opposed to a desktop entry. We 
+             * should break here to avoid the entry data being overwritten 
+             * with action data */
+            if (started) break;
             continue;
         }
-        if (id == "Terminal")
+        if (equals == NULL || keyLength == 0) continue;
+        EntryKey key = matchKey(lineStart, keyLength);
+        if (key == keyNone) continue;
+
+        std::string line(lineStart, lineEnd);
+        switch (key)
         {
-            std::string value = getSingleValue(line);
-            if (value == "True" || value == "true")
-                terminal = true;
-            continue;
+            case keyName:
+                name = getSingleValue(line);
+                break;
+            case keyExec:
+                exec = getSingleValue(line);
+                break;
+            case keyCategories:
+                foundCategories = getMultiValue(line);
+                break;
+            case keyNoDisplay:
+                if (isTrue(line)) nodisplay = true;
+                break;
+            case keyOnlyShowIn:
+                onlyShowInDesktops = getMultiValue(line);
+                break;
+            case keyIcon:
+                iconDef = getSingleValue(line);
+                break;
+            case keyTerminal:
+                if (isTrue(line)) terminal = true;
+                break;
+            case keyTryExec:
+                tryExec = getSingleValue(line);
+                break;
+            case keyHidden:
+                if (isTrue(line)) hidden = true;
+                break;
+            default:
+                break;
         }
     }
+    return true;
+}
 
-    if (this->name == "" || this->exec == "") return;
-    else
+/* Return whether the value of a boolean key is true */
+bool DesktopFile::isTrue(const std::string& line)
+{
+    std::string value = getSingleValue(line);
+    return value == "True" || value == "true";
+}
+
+/* Add the entry to the table, associating it with categories, finding its 
+ * icon and so on. Return the row of the entry, or -1 if the entry shouldn't 
+ * be shown at all. Entries which can't be run should already have been 
+ * hidden by hideUnavailable() */
+int DesktopFile::addTo(EntryTable& entries, std::vector<Category*>& cats, 
+        const RunConfig& config, const std::vector<IconSpec>& iconpaths)
+{  
+    if (this->name == "" || this->exec == "" || hidden) return -1;
+
+    //Convert some base categories to more commonly used categories. Only 
+    //categories which some menu category matches on have ids
+    std::vector<uint16_t> categoryIds;
+    std::vector<std::string>::iterator it = foundCategories.begin();
+    while (it < foundCategories.end())
     {
-        processCategories(cats, foundCategories);
-        if (useIcons && iconDef != "") 
-            matchIcon(iconDef, iconpaths, iconsXdgSize, iconsXdgOnly);
-        if (!onlyShowInDesktops.empty()) 
-            processDesktops(showFromDesktops, onlyShowInDesktops);
-        if (terminal) this->exec = term + " " + this->exec;
+        if (*it == "AudioVideo" || *it == "Audio" || *it == "Video") 
+            *it = "Multimedia";
+        if (*it == "Network") *it = "Internet";
+        if (*it == "Utility") *it = "Accessories";
+        categoryIds.push_back(entries.findCategory(*it));
+        it++;
     }
+    if (!onlyShowInDesktops.empty() && !processDesktops(config.showFromDesktops)) 
+        nodisplay = true;
+
+    unsigned int entry = entries.add(filename, name, exec, "", 
+            (nodisplay ? ENTRY_NODISPLAY : 0) | (terminal ? ENTRY_TERMINAL : 0),
+            categoryIds);
+    //Entries which aren't in any category won't be shown, so there's 
+    //no need to look for their icons
+    bool registered = processCategories(entries, entry, cats);
+    if (config.entryIcons && iconDef != "" && registered) 
+        entries.setIcon(entry, matchIcon(iconpaths, config.iconsXdgSize, 
+                    config.iconsXdgOnly));
+    return entry;
 }
 
 /* This function is used to get the single value before the = sign.
@@ -176,12 +376,14 @@ std::string DesktopFile::getSingleValue(const std::string& line, const char star
 
     //Some names include a trailing space. For matching, it's best if we 
     //remove these
-    if (readChars[readChars.size() - 1] == ' ') 
+    if (!readChars.empty() && readChars[readChars.size() - 1] == ' ') 
         readChars.erase(readChars.end() - 1);
     value = std::string(readChars.begin(), readChars.end());
     //Throw away field codes like %F, most WMs don't appear to handle these
     std::string::iterator fieldCode = find(value.begin(), value.end(), '%');
-    if (fieldCode != value.end()) value.erase(fieldCode - 1, value.end());
+    if (fieldCode != value.end()) 
+        value.erase(fieldCode == value.begin() ? fieldCode : fieldCode - 1, 
+                value.end());
 
     return value;
 }
@@ -220,28 +422,18 @@ std::vector<std::string> DesktopFile::getMultiValue(const std::string& line, con
 
 /* Add the desktop entry to the appropriate categories, based on what was read 
  * from the file. If we can't find a category, add the entry to the Other 
- * category which is the catchall */
-void DesktopFile::processCategories(std::vector<Category*>& cats, 
-        std::vector<std::string>& foundCategories)
+ * category which is the catchall. Return whether the entry was added to any
+ * category */
+bool DesktopFile::processCategories(EntryTable& entries, unsigned int entry, 
+        std::vector<Category*>& cats)
 {   
     bool hasCategory = false;
-    std::vector<std::string>::iterator it = foundCategories.begin();
-
-    //Convert some base categories to more commonly used categories
-    while (it < foundCategories.end())
-    {
-        if (*it == "AudioVideo" || *it == "Audio" || *it == "Video") 
-            *it = "Multimedia";
-        if (*it == "Network") *it = "Internet";
-        if (*it == "Utility") *it = "Accessories";
-        it++;
-    }
 
-    //Loop through our category objects, adding the desktop entry name to the 
+    //Loop through our category objects, adding the desktop entry to the 
     //category if appropriate
     for (unsigned int x = 0; x < cats.size(); x++)
     {
-        bool registered = cats[x]->registerDF(this);
+        bool registered = cats[x]->registerEntry(entries, entry);
         if (registered) hasCategory = true;
     }
 
@@ -253,19 +445,19 @@ void DesktopFile::processCategories(std::vector<Category*>& cats,
         {
             if (cats[x]->name == "Other")
             {
-                cats[x]->registerDF(this, true);
-                break;
+                cats[x]->registerEntry(entries, entry, true);
+                return true;
             }
         }
     }
+    return hasCategory;
 }
 
 /* Function which attempts to find the full path for a desktop entry by going
  * through a list of icons, attempting to match the icon entry in the entry
- * against each icon path */
-void DesktopFile::matchIcon(const std::string& iconDef, 
-        const std::vector<IconSpec>& iconpaths, const std::string& iconsXdgSize, 
-        bool iconsXdgOnly)
+ * against each icon path. Returns an empty string if there is no match */
+std::string DesktopFile::matchIcon(const std::vector<IconSpec>& iconpaths, 
+        const std::string& iconsXdgSize, bool iconsXdgOnly)
 {   
     //This is a kludge. If the iconDef is a path and it conforms to the 
     //required size then just use that and return
@@ -274,10 +466,7 @@ void DesktopFile::matchIcon(const std::string& iconDef,
     {   
         if (!iconsXdgOnly || (iconsXdgOnly && 
                 iconDef.find("/share/icons/") != std::string::npos))
-        {   
-            icon = iconDef;
-            return;
-        }
+            return iconDef;
     }
     /* Here we search through the icon locations provided, trying to match the 
      * definition to a full path. Note that the first matching icon found will 
@@ -285,37 +474,31 @@ void DesktopFile::matchIcon(const std::string& iconDef,
     for (unsigned int x = 0; x < iconpaths.size(); x++)
     {   
         if (iconDef == iconpaths[x].def || iconDef == iconpaths[x].id)
-        {
-            icon = iconpaths[x].path;
-            break;
-        }
+            return iconpaths[x].path;
     }
+    return "";
 }
 
 /* This function handles desktop entries that specify they should only be 
  * displayed in certain desktops. If the user specifies that OnlyShowIn 
  * entries from a matching desktop should be displayed then the function will 
- * return and the nodisplay value will be left untouched. If not, it will be set
- * to true */
-void DesktopFile::processDesktops(const std::vector<std::string>& showInDesktops, 
-        const std::vector<std::string>& onlyShowInDesktops)
+ * return true. If not, it will return false and the entry should be given 
+ * nodisplay */
+bool DesktopFile::processDesktops(const std::vector<std::string>& showInDesktops)
 {   
     //First check for all or none
     for (unsigned int x = 0; x < showInDesktops.size(); x++)
     {
-        if (showInDesktops[x] == "all") return;
+        if (showInDesktops[x] == "all") return true;
         if (showInDesktops[x] == "none" && !onlyShowInDesktops.empty())
-        {
-            nodisplay = true;
-            return;
-        }
+            return false;
     }
     //Now loop through the entry OnlyShowIn desktops
     for (unsigned int x = 0; x < onlyShowInDesktops.size(); x++)
     {   
         if (find(showInDesktops.begin(), showInDesktops.end(), 
                 onlyShowInDesktops[x]) != showInDesktops.end())
-            return;
+            return true;
     }
-    nodisplay = true;
+    return false;
 }
@@ -32,41 +32,55 @@ struct IconSpec
 };
 
 class Category;
+class ParseCache;
+class ExecIndex;
+class EntryTable;
+class RunConfig;
+struct InputLimits;
 
+/* Reads the values we need from a .desktop file. The entry is then added to 
+ * an EntryTable with addTo, after which the DesktopFile is no longer needed */
 class DesktopFile
 {
     public:
-        DesktopFile(const char *filename, std::vector<std::string> showFromDesktops, 
-                bool useIcons, const std::vector<IconSpec>& iconpaths, 
-                std::vector<Category*>& cats, const std::string& iconsXdgSize, 
-                bool iconsXdgOnly, const std::string& term);
+        static std::vector<DesktopFile*> readAll(
+                const std::vector<std::string>& paths, ParseCache *cache, 
+                bool useUring, const InputLimits& limits);
+        static void hideUnavailable(std::vector<DesktopFile*>& files,
+                const RunConfig& config, ExecIndex *execIndex);
+        static void dedupe(std::vector<DesktopFile*>& files);
 
         std::string filename;
-        std::string basename;
         std::string name;
         std::string exec;
         bool nodisplay;
-        std::string icon;
         bool terminal;
+        bool hidden;
         std::vector<std::string> foundCategories;
 
+        int addTo(EntryTable& entries, std::vector<Category*>& cats, 
+                const RunConfig& config, const std::vector<IconSpec>& iconpaths);
+
         static std::string getID(const std::string& line, const char start = '\0', const char end = '=');
         static std::string getSingleValue(const std::string& line, const char start = '=', const char end = '\0');
         static std::vector<std::string> getMultiValue(const std::string& line, const char separator = ';', const char start = '=');
  
     private:
-        std::ifstream dfile;
+        std::string iconDef;
+        std::string tryExec;
+        std::vector<std::string> onlyShowInDesktops;
+
+        friend class ParseCache;
 
-        void populate(const std::vector<std::string>& showFromDesktops, bool useIcons, 
-                const std::vector<IconSpec>& iconpaths, std::vector<Category*>& cats, 
-                const std::string& iconsXdgSize, bool iconsXdgOnly, 
-                const std::string& term);
-        void matchIcon(const std::string& iconDef, const std::vector<IconSpec>& iconpaths,
+        DesktopFile(const std::string& filename);
+        bool populate(const std::vector<char>& data, unsigned int maxLine);
+        static bool isTrue(const std::string& line);
+        static std::string normalize(const std::string& value, bool lowerCase);
+        std::string matchIcon(const std::vector<IconSpec>& iconpaths,
                 const std::string& iconsXdgSize, bool iconsXdgOnly);
-        void processCategories(std::vector<Category*>& cats, 
-                std::vector<std::string>& foundCategories);
-        void processDesktops(const std::vector<std::string>& showFromDesktops, 
-                const std::vector<std::string>& onlyShowInDesktops);
+        bool processCategories(EntryTable& entries, unsigned int entry, 
+                std::vector<Category*>& cats);
+        bool processDesktops(const std::vector<std::string>& showFromDesktops);
 };
 
 #endif
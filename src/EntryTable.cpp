@@ -0,0 +1,126 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include "EntryTable.h"
+
+EntryTable::EntryTable() :
+    termPrefix("xterm -e ")
+{  
+    //Offset 0 is the empty string, shared by all entries without an icon
+    pool.push_back('\0');
+}
+
+/* Add a string to the end of the pool and return its offset */
+uint32_t EntryTable::poolString(const std::string& str)
+{
+    if (str.empty()) return 0;
+    uint32_t offset = pool.size();
+    pool.insert(pool.end(), str.begin(), str.end());
+    pool.push_back('\0');
+    return offset;
+}
+
+/* Add an entry and return its row. Category ids past MAX_ENTRY_CATEGORIES
+ * are dropped */
+unsigned int EntryTable::add(const std::string& filename, const std::string& name,
+        const std::string& exec, const std::string& icon, uint8_t entryFlags,
+        const std::vector<uint16_t>& categories)
+{
+    uint32_t filenameOffset = poolString(filename);
+    filenames.push_back(filenameOffset);
+    basenames.push_back(filenameOffset + filename.find_last_of("/") + 1);
+    names.push_back(poolString(name));
+    execs.push_back(poolString(exec));
+    icons.push_back(poolString(icon));
+    flags.push_back(entryFlags);
+    unsigned int count = 0;
+    for (unsigned int x = 0; x < categories.size() &&
+            count < MAX_ENTRY_CATEGORIES; x++)
+    {
+        if (categories[x] == NO_CATEGORY) continue;
+        categoryIds.push_back(categories[x]);
+        count++;
+    }
+    for (unsigned int x = count; x < MAX_ENTRY_CATEGORIES; x++)
+        categoryIds.push_back(NO_CATEGORY);
+    categoryCounts.push_back(count);
+    return names.size() - 1;
+}
+
+void EntryTable::setNodisplay(unsigned int row, bool nodisplay)
+{
+    if (nodisplay) flags[row] |= ENTRY_NODISPLAY;
+    else flags[row] &= ~ENTRY_NODISPLAY;
+}
+
+/* Set the icon of an entry. The old icon, if any, is left unused in the pool 
+ * so this is meant for entries which were added without one */
+void EntryTable::setIcon(unsigned int row, const std::string& icon)
+{
+    icons[row] = poolString(icon);
+}
+
+/* Set the terminal command used to run terminal based entries, e.g.
+ * xterm -e */
+void EntryTable::setTerminal(const std::string& term)
+{
+    termPrefix = term + " ";
+}
+
+bool EntryTable::hasCategory(unsigned int row, uint16_t id) const
+{
+    const uint16_t *ids = &categoryIds[row * MAX_ENTRY_CATEGORIES];
+    for (unsigned int x = 0; x < categoryCounts[row]; x++)
+        if (ids[x] == id) return true;
+    return false;
+}
+
+/* Return the id for a category name, giving it one if it doesn't have one */
+uint16_t EntryTable::internCategory(const std::string& category)
+{
+    std::map<std::string, uint16_t>::iterator it = categoryIndex.find(category);
+    if (it != categoryIndex.end()) return it->second;
+    if (categoryIndex.size() >= NO_CATEGORY) return NO_CATEGORY;
+    uint16_t id = categoryIndex.size();
+    categoryIndex[category] = id;
+    return id;
+}
+
+/* Return the id for a category name, or NO_CATEGORY if it doesn't have one */
+uint16_t EntryTable::findCategory(const std::string& category) const
+{
+    std::map<std::string, uint16_t>::const_iterator it =
+        categoryIndex.find(category);
+    if (it == categoryIndex.end()) return NO_CATEGORY;
+    return it->second;
+}
+
+bool EntryTable::NameCompare::operator()(unsigned int a, unsigned int b) const
+{
+    const unsigned char *name_a = (const unsigned char*)entries->name(a);
+    const unsigned char *name_b = (const unsigned char*)entries->name(b);
+    while (*name_a != '\0' && tolower(*name_a) == tolower(*name_b))
+    {
+        name_a++;
+        name_b++;
+    }
+    return (unsigned char)tolower(*name_a) < (unsigned char)tolower(*name_b);
+}
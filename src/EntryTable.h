@@ -0,0 +1,103 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ENTRY_TABLE_H_
+#define _ENTRY_TABLE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+//Entry flags
+#define ENTRY_NODISPLAY 0x1
+#define ENTRY_TERMINAL 0x2
+
+//The most category ids kept per entry. Only categories which some menu
+//category matches on are kept, so this is rarely reached
+#define MAX_ENTRY_CATEGORIES 8
+#define NO_CATEGORY 0xffff
+
+/* The desktop entries which made it into the menu, stored as columns. Each
+ * string column holds offsets into a single string pool, categories are
+ * small interned ids and the nodisplay and terminal states are bit flags. An
+ * entry is identified by its row number */
+class EntryTable
+{
+    public:
+        EntryTable();
+
+        unsigned int size() const { return names.size(); }
+
+        unsigned int add(const std::string& filename, const std::string& name,
+                const std::string& exec, const std::string& icon,
+                uint8_t entryFlags, const std::vector<uint16_t>& categories);
+
+        const char *filename(unsigned int row) const
+            { return &pool[filenames[row]]; }
+        const char *basename(unsigned int row) const
+            { return &pool[basenames[row]]; }
+        const char *name(unsigned int row) const { return &pool[names[row]]; }
+        const char *exec(unsigned int row) const { return &pool[execs[row]]; }
+        const char *icon(unsigned int row) const { return &pool[icons[row]]; }
+        bool hasIcon(unsigned int row) const { return pool[icons[row]] != '\0'; }
+        bool nodisplay(unsigned int row) const
+            { return flags[row] & ENTRY_NODISPLAY; }
+        bool terminal(unsigned int row) const
+            { return flags[row] & ENTRY_TERMINAL; }
+        void setNodisplay(unsigned int row, bool nodisplay);
+        void setIcon(unsigned int row, const std::string& icon);
+
+        const std::string& execPrefix(unsigned int row) const
+            { return terminal(row) ? termPrefix : noPrefix; }
+        void setTerminal(const std::string& term);
+
+        bool hasCategory(unsigned int row, uint16_t id) const;
+        uint16_t internCategory(const std::string& category);
+        uint16_t findCategory(const std::string& category) const;
+
+        //Orders rows by name, ignoring case
+        struct NameCompare
+        {   const EntryTable *entries;
+
+            NameCompare(const EntryTable *entries) : entries(entries) {}
+            bool operator()(unsigned int a, unsigned int b) const;
+        };
+
+    private:
+        std::vector<char> pool;
+        std::vector<uint32_t> filenames;
+        std::vector<uint32_t> basenames;
+        std::vector<uint32_t> names;
+        std::vector<uint32_t> execs;
+        std::vector<uint32_t> icons;
+        std::vector<uint8_t> flags;
+        std::vector<uint8_t> categoryCounts;
+        std::vector<uint16_t> categoryIds;
+        std::map<std::string, uint16_t> categoryIndex;
+        std::string termPrefix;
+        std::string noPrefix;
+
+        friend class Snapshot;
+
+        uint32_t poolString(const std::string& str);
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "Escape.h"
+
+struct EscapeRule
+{   char c;
+    const char *replacement;
+};
+
+/* Double quoted strings in mwm, olvwm, icewm and Windowmaker menus, and menu
+ * names in fvwm */
+static const EscapeRule quotedRules[] = 
+    {{'"', "\\\""}, {'\\', "\\\\"}, {'\0', NULL}};
+/* fvwm item labels, where &, % and * mark hotkeys, icons and side pictures 
+ * unless doubled */
+static const EscapeRule fvwmLabelRules[] = 
+    {{'"', "\\\""}, {'\\', "\\\\"}, {'&', "&&"}, {'%', "%%"}, {'*', "**"}, 
+        {'\0', NULL}};
+/* Fluxbox labels end at ) and commands at } */
+static const EscapeRule fluxboxLabelRules[] = {{')', "\\)"}, {'\0', NULL}};
+static const EscapeRule fluxboxCommandRules[] = {{'}', "\\}"}, {'\0', NULL}};
+/* Openbox attributes and text */
+static const EscapeRule xmlRules[] = 
+    {{'&', "&amp;"}, {'<', "&lt;"}, {'>', "&gt;"}, {'"', "&quot;"}, 
+        {'\0', NULL}};
+
+static const EscapeRule *const formatRules[NUM_ESCAPE_FORMATS] = 
+    {quotedRules, fvwmLabelRules, fluxboxLabelRules, fluxboxCommandRules, 
+        xmlRules};
+
+//The replacement for each byte in each format, or NULL to write it as it is
+static const char *escapeTable[NUM_ESCAPE_FORMATS][256];
+
+static bool buildEscapeTable()
+{
+    for (int x = 0; x < NUM_ESCAPE_FORMATS; x++)
+    {
+        for (const EscapeRule *rule = formatRules[x]; rule->replacement; rule++)
+            escapeTable[x][(unsigned char)rule->c] = rule->replacement;
+    }
+    return true;
+}
+
+//Built before main, so writers on several threads can share the table
+static const bool escapeTableBuilt = buildEscapeTable();
+
+Escape::Escape(const char *value, EscapeFormat format) :
+    value(value),
+    length(strlen(value)),
+    format(format)
+{
+}
+
+Escape::Escape(const std::string& value, EscapeFormat format) :
+    value(value.data()),
+    length(value.size()),
+    format(format)
+{
+}
+
+/* Write a string escaped for a format in one pass over it, using the table 
+ * to find the characters which need replacing */
+void Escape::write(std::ostream& out, const char *value, 
+        std::string::size_type length, EscapeFormat format)
+{
+    const char *const *table = escapeTable[format];
+    std::string::size_type start = 0;
+    for (std::string::size_type x = 0; x < length; x++)
+    {
+        const char *replacement = table[(unsigned char)value[x]];
+        if (replacement == NULL) continue;
+        out.write(value + start, x - start);
+        out << replacement;
+        start = x + 1;
+    }
+    out.write(value + start, length - start);
+}
+
+std::ostream& operator<<(std::ostream& out, const Escape& escape)
+{
+    Escape::write(out, escape.value, escape.length, escape.format);
+    return out;
+}
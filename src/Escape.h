@@ -0,0 +1,59 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ESCAPE_H_
+#define _ESCAPE_H_
+
+#include <string>
+#include <ostream>
+
+//The ways a string can be escaped for the menu formats
+enum EscapeFormat
+{
+    escapeQuoted = 0,
+    escapeFvwmLabel,
+    escapeFluxboxLabel,
+    escapeFluxboxCommand,
+    escapeXml
+};
+
+#define NUM_ESCAPE_FORMATS 5
+
+/* A string to be written to a menu escaped for its format, e.g.
+ * out << Escape(name, escapeXml). The string is written straight to the 
+ * stream in runs between the characters which need escaping, so strings 
+ * which need none are written in one go */
+class Escape
+{
+    public:
+        Escape(const char *value, EscapeFormat format);
+        Escape(const std::string& value, EscapeFormat format);
+
+        const char *value;
+        std::string::size_type length;
+        EscapeFormat format;
+
+        static void write(std::ostream& out, const char *value, 
+                std::string::size_type length, EscapeFormat format);
+};
+
+std::ostream& operator<<(std::ostream& out, const Escape& escape);
+
+#endif
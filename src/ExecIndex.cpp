@@ -0,0 +1,78 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ExecIndex.h"
+#include "ParseCache.h"
+#include "DesktopFile.h"
+
+ExecIndex::ExecIndex(ParseCache *cache) :
+    cache(cache),
+    built(false)
+{
+}
+
+/* Read the names in each $PATH directory once. The listings come from the
+ * parse cache, so a directory is only read again if it has changed */
+void ExecIndex::build()
+{
+    built = true;
+    const char *path = getenv("PATH");
+    if (path == NULL) return;
+    std::vector<std::string> dirs = 
+        DesktopFile::getMultiValue(path, ':', '\0');
+    for (unsigned int x = 0; x < dirs.size(); x++)
+    {
+        if (dirs[x].empty()) continue;
+        std::vector<std::string> names;
+        cache->listNames(dirs[x], names);
+        programs.insert(names.begin(), names.end());
+    }
+}
+
+/* Return whether a program can be run. Paths are checked directly, while 
+ * bare names are looked up in the index of $PATH */
+bool ExecIndex::available(const std::string& program)
+{
+    if (program.empty()) return false;
+    if (program.find('/') != std::string::npos)
+        return access(program.c_str(), X_OK) == 0;
+    if (!built) build();
+    return programs.find(program) != programs.end();
+}
+
+/* Return the program part of an Exec value, i.e. the first argument, which
+ * may be quoted */
+std::string ExecIndex::getProgram(const std::string& exec)
+{
+    std::string::size_type start = exec.find_first_not_of(' ');
+    if (start == std::string::npos) return "";
+    if (exec[start] == '"')
+    {
+        std::string::size_type end = exec.find('"', start + 1);
+        if (end == std::string::npos) return exec.substr(start + 1);
+        return exec.substr(start + 1, end - start - 1);
+    }
+    std::string::size_type end = exec.find(' ', start);
+    if (end == std::string::npos) return exec.substr(start);
+    return exec.substr(start, end - start);
+}
@@ -0,0 +1,46 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EXEC_INDEX_H_
+#define _EXEC_INDEX_H_
+
+#include <string>
+#include <boost/unordered_set.hpp>
+
+class ParseCache;
+
+class ExecIndex
+{
+    public:
+        ExecIndex(ParseCache *cache);
+
+        bool available(const std::string& program);
+
+        static std::string getProgram(const std::string& exec);
+
+    private:
+        ParseCache *cache;
+        bool built;
+        boost::unordered_set<std::string> programs;
+
+        void build();
+};
+
+#endif
@@ -0,0 +1,406 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "FileReader.h"
+
+#ifdef HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define NO_INDEX 0xffffffff
+#endif
+
+FileReader::FileReader(const std::vector<std::string>& paths, bool useUring,
+        unsigned int maxSize) :
+    paths(paths),
+    nextPath(0),
+    maxSize(maxSize)
+#ifdef HAVE_IO_URING
+    ,
+    ringFd(-1),
+    sqRing(MAP_FAILED),
+    cqRing(MAP_FAILED),
+    sqes(MAP_FAILED),
+    toSubmit(0),
+    inFlight(0)
+#endif
+{
+#ifdef HAVE_IO_URING
+    if (useUring && !paths.empty()) setupRing();
+#endif
+}
+
+FileReader::~FileReader()
+{
+#ifdef HAVE_IO_URING
+    if (ringFd >= 0)
+    {
+        drainRing();
+        closeRing();
+        for (unsigned int x = 0; x < slots.size(); x++)
+            if (slots[x].index != NO_INDEX && slots[x].fd >= 0) 
+                close(slots[x].fd);
+    }
+#endif
+}
+
+/* Read a whole file into data, stopping once more than maxSize bytes have 
+ * been read. Return false if it can't be opened */
+bool FileReader::readFile(const char *filename, std::vector<char>& data,
+        unsigned int maxSize)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) 
+        data.reserve(std::min((size_t)st.st_size, (size_t)maxSize + 1));
+    char chunk[4096];
+    ssize_t count;
+    while (data.size() <= maxSize && 
+            (count = read(fd, chunk, sizeof(chunk))) > 0)
+        data.insert(data.end(), chunk, chunk + count);
+    if (data.size() > (size_t)maxSize + 1) data.resize((size_t)maxSize + 1);
+    close(fd);
+    return true;
+}
+
+/* Read a file as a list of lines, split the way getline would split them. 
+ * Return false if it can't be opened, or, with a message, if it is larger 
+ * than maxSize or has a line longer than maxLine */
+bool FileReader::readLines(const std::string& filename, 
+        std::vector<std::string>& lines, unsigned int maxSize, 
+        unsigned int maxLine)
+{
+    std::vector<char> data;
+    if (!readFile(filename.c_str(), data, maxSize)) return false;
+    if (data.size() > maxSize)
+    {
+        reportSkipped(filename, "larger than", maxSize);
+        return false;
+    }
+    lines.clear();
+    //With a newline after the last line, every line ends at one
+    data.push_back('\n');
+    const char *pos = &data[0];
+    const char *end = pos + data.size() - 1;
+    while (true)
+    {
+        const char *lineEnd = (const char*)memchr(pos, '\n', end + 1 - pos);
+        if ((size_t)(lineEnd - pos) > maxLine)
+        {
+            reportSkipped(filename, "has a line longer than", maxLine);
+            lines.clear();
+            return false;
+        }
+        lines.push_back(std::string(pos, lineEnd));
+        if (lineEnd == end) break;
+        pos = lineEnd + 1;
+    }
+    return true;
+}
+
+/* Say that a file has been skipped for going over one of the input limits */
+void FileReader::reportSkipped(const std::string& filename, const char *reason, 
+        unsigned int limit)
+{
+    std::cerr << "mwmmenu: skipping " << filename << ": " << reason << " " << 
+        limit << " bytes" << std::endl;
+}
+
+/* Get the next file which has been read. index is its position in the list 
+ * of paths and readable is false if it couldn't be opened. Returns false 
+ * when every file has been handed back */
+bool FileReader::next(unsigned int& index, std::vector<char>& data, bool& readable)
+{
+#ifdef HAVE_IO_URING
+    while (ringFd >= 0 && done.empty())
+    {
+        //Start on more files while there is room
+        while (!freeSlots.empty() && nextPath < paths.size())
+        {
+            unsigned int slot = freeSlots.back();
+            freeSlots.pop_back();
+            startOpen(slot);
+        }
+        if (inFlight == 0) return false;
+        if (!reap()) abandonRing();
+    }
+    if (!done.empty())
+    {
+        index = done.front().index;
+        data.swap(done.front().data);
+        readable = done.front().readable;
+        done.pop_front();
+        return true;
+    }
+#endif
+    if (nextPath >= paths.size()) return false;
+    index = nextPath++;
+    data.clear();
+    readable = readFile(paths[index].c_str(), data, maxSize);
+    return true;
+}
+
+#ifdef HAVE_IO_URING
+
+/* Set up an io_uring with its submission and completion queues mapped into 
+ * memory. If the kernel doesn't allow it, the files are read one after 
+ * another instead */
+bool FileReader::setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = syscall(__NR_io_uring_setup, READER_QUEUE_DEPTH, &params);
+    if (ringFd < 0) return false;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cqRingSize = params.cq_off.cqes + 
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, 
+            MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing != MAP_FAILED && singleMap) cqRing = sqRing;
+    else if (sqRing != MAP_FAILED)
+        cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, 
+                MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (cqRing != MAP_FAILED)
+        sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, 
+                MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        closeRing();
+        return false;
+    }
+
+    char *sq = static_cast<char*>(sqRing);
+    char *cq = static_cast<char*>(cqRing);
+    sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    //Each slot has at most one request in the queues at a time, so neither 
+    //queue can overflow
+    slots.resize(std::min((unsigned int)READER_QUEUE_DEPTH, params.sq_entries));
+    for (unsigned int x = slots.size(); x > 0; x--)
+    {
+        slots[x - 1].index = NO_INDEX;
+        freeSlots.push_back(x - 1);
+    }
+    return true;
+}
+
+void FileReader::closeRing()
+{
+    if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+    if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+    sqes = cqRing = sqRing = MAP_FAILED;
+    close(ringFd);
+    ringFd = -1;
+}
+
+/* Wait for every request the kernel has been given to complete, so none of
+ * them can still be writing into a slot's buffer. Files opened by them are 
+ * closed again, since nothing will read them now */
+void FileReader::drainRing()
+{
+    unsigned int submitted = inFlight - toSubmit;
+    unsigned int head = *cqHead;
+    while (submitted > 0)
+    {
+        unsigned int tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail && submitted > 0)
+        {
+            struct io_uring_cqe *cqe = 
+                static_cast<struct io_uring_cqe*>(cqes) + (head & cqMask);
+            if (slots[cqe->user_data].fd < 0 && cqe->res >= 0) close(cqe->res);
+            head++;
+            submitted--;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        if (submitted > 0 && syscall(__NR_io_uring_enter, ringFd, 0, 1, 
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            break;
+    }
+    inFlight = toSubmit = 0;
+}
+
+/* Give up on io_uring part way through. The files being read are read again
+ * the ordinary way and the rest are read one after another by next(). The 
+ * files read again go into buffers of their own, in case the ring stopped 
+ * working before all the requests in it could be waited for */
+void FileReader::abandonRing()
+{
+    drainRing();
+    closeRing();
+    for (unsigned int x = 0; x < slots.size(); x++)
+    {
+        if (slots[x].index == NO_INDEX) continue;
+        if (slots[x].fd >= 0) close(slots[x].fd);
+        slots[x].fd = -1;
+        done.push_back(Slot());
+        done.back().index = slots[x].index;
+        done.back().readable = readFile(paths[slots[x].index].c_str(), 
+                done.back().data, maxSize);
+        slots[x].index = NO_INDEX;
+    }
+}
+
+/* Queue a request to open the next file */
+void FileReader::startOpen(unsigned int slot)
+{
+    Slot& s = slots[slot];
+    s.index = nextPath++;
+    s.fd = -1;
+    s.offset = 0;
+    s.data.clear();
+
+    unsigned int tail = *sqTail;
+    unsigned int pos = tail & sqMask;
+    struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe*>(sqes) + pos;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long)paths[s.index].c_str();
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = slot;
+    sqArray[pos] = pos;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+    inFlight++;
+}
+
+/* Queue a request to read more of an open file. Each read asks for as much 
+ * as has been read so far, so large files take few reads, but no read goes 
+ * past maxSize + 1 bytes */
+void FileReader::startRead(unsigned int slot)
+{
+    Slot& s = slots[slot];
+    size_t want = s.offset == 0 ? READER_FIRST_READ : s.offset;
+    want = std::min(want, (size_t)maxSize + 1 - s.offset);
+    s.data.resize(s.offset + want);
+
+    unsigned int tail = *sqTail;
+    unsigned int pos = tail & sqMask;
+    struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe*>(sqes) + pos;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = s.fd;
+    sqe->addr = (unsigned long)&s.data[s.offset];
+    sqe->len = want;
+    sqe->off = s.offset;
+    sqe->user_data = slot;
+    sqArray[pos] = pos;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+    inFlight++;
+}
+
+/* Submit the queued requests, wait for at least one to complete and deal 
+ * with all those which have. Returns false if the ring has stopped working */
+bool FileReader::reap()
+{
+    int submitted = syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, 
+            IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted < 0) 
+        return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+    toSubmit -= submitted;
+
+    unsigned int head = *cqHead;
+    unsigned int tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        struct io_uring_cqe *cqe = 
+            static_cast<struct io_uring_cqe*>(cqes) + (head & cqMask);
+        unsigned int slot = cqe->user_data;
+        int result = cqe->res;
+        head++;
+        inFlight--;
+        complete(slot, result);
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Deal with a completed open or read. If the kernel can't do either, for 
+ * example because it is too old for them, the file is read the ordinary way 
+ * which also tells unreadable files apart */
+void FileReader::complete(unsigned int slot, int result)
+{
+    Slot& s = slots[slot];
+    if (s.fd < 0)
+    {
+        if (result < 0) 
+            finish(slot, readFile(paths[s.index].c_str(), s.data, maxSize));
+        else 
+        {
+            s.fd = result;
+            startRead(slot);
+        }
+        return;
+    }
+    if (result < 0)
+    {
+        close(s.fd);
+        s.fd = -1;
+        s.data.clear();
+        finish(slot, readFile(paths[s.index].c_str(), s.data, maxSize));
+        return;
+    }
+    size_t asked = s.data.size() - s.offset;
+    s.offset += result;
+    if ((size_t)result == asked && s.offset <= maxSize)
+    {
+        startRead(slot);
+        return;
+    }
+    s.data.resize(s.offset);
+    close(s.fd);
+    s.fd = -1;
+    finish(slot, true);
+}
+
+/* Hand a file on to next() and free its slot */
+void FileReader::finish(unsigned int slot, bool readable)
+{
+    done.push_back(Slot());
+    done.back().index = slots[slot].index;
+    done.back().data.swap(slots[slot].data);
+    done.back().readable = readable;
+    slots[slot].index = NO_INDEX;
+    freeSlots.push_back(slot);
+}
+
+#endif
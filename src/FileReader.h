@@ -0,0 +1,113 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FILE_READER_H_
+#define _FILE_READER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#ifdef __linux__
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0)
+#define HAVE_IO_URING
+#endif
+#endif
+
+//The most files read at once with io_uring
+#define READER_QUEUE_DEPTH 64
+//The first read of each file asks for this much, larger files take more reads
+#define READER_FIRST_READ 16384
+
+/* Reads a list of whole files and hands each one back as soon as it has been
+ * read, which with io_uring isn't necessarily in the order given. At most 
+ * maxSize + 1 bytes of each file are read, so callers can tell files which 
+ * are too large apart without reading all of them. With 
+ * io_uring, the opens and reads of many files are submitted together, so 
+ * they don't wait on each other. This matters for thousands of small files 
+ * on a cold cache or a network home. Where io_uring isn't available or isn't
+ * wanted, the files are read one after another */
+class FileReader
+{
+    public:
+        FileReader(const std::vector<std::string>& paths, bool useUring, 
+                unsigned int maxSize);
+        ~FileReader();
+
+        bool next(unsigned int& index, std::vector<char>& data, bool& readable);
+
+        static bool readFile(const char *filename, std::vector<char>& data,
+                unsigned int maxSize);
+        static bool readLines(const std::string& filename, 
+                std::vector<std::string>& lines, unsigned int maxSize, 
+                unsigned int maxLine);
+        static void reportSkipped(const std::string& filename, 
+                const char *reason, unsigned int limit);
+
+    private:
+        const std::vector<std::string>& paths;
+        unsigned int nextPath;
+        unsigned int maxSize;
+
+#ifdef HAVE_IO_URING
+        //A file being read
+        struct Slot
+        {   unsigned int index;
+            int fd;
+            std::vector<char> data;
+            size_t offset;
+            bool readable;
+        };
+
+        int ringFd;
+        void *sqRing;
+        size_t sqRingSize;
+        void *cqRing;
+        size_t cqRingSize;
+        void *sqes;
+        size_t sqesSize;
+        unsigned int *sqHead;
+        unsigned int *sqTail;
+        unsigned int sqMask;
+        unsigned int *sqArray;
+        unsigned int *cqHead;
+        unsigned int *cqTail;
+        unsigned int cqMask;
+        void *cqes;
+        unsigned int toSubmit;
+        unsigned int inFlight;
+        std::vector<Slot> slots;
+        std::vector<unsigned int> freeSlots;
+        std::deque<Slot> done;
+
+        bool setupRing();
+        void closeRing();
+        void startOpen(unsigned int slot);
+        void startRead(unsigned int slot);
+        void complete(unsigned int slot, int result);
+        void finish(unsigned int slot, bool readable);
+        bool reap();
+        void drainRing();
+        void abandonRing();
+#endif
+};
+
+#endif
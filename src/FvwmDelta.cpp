@@ -0,0 +1,113 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "FvwmDelta.h"
+#include "MenuDigest.h"
+
+/* Return the menus of an FVWM menu which are new or have changed since the
+ * state file was last saved, followed by DestroyMenu for each menu which 
+ * has gone. The state to save once the result has been written is put in 
+ * newState. Without a state file, all the menus are returned */
+std::string FvwmDelta::filter(const std::string& menu, const std::string& statePath,
+        std::string& newState)
+{
+    std::map<std::string, std::string> oldState;
+    std::ifstream state_f(statePath.c_str());
+    std::string line;
+    while (getline(state_f, line))
+    {
+        if (line.size() > 17 && line[16] == ' ')
+            oldState[line.substr(17)] = line.substr(0, 16);
+    }
+    state_f.close();
+
+    //Split the menu into the blocks written for each menu, starting from 
+    //each DestroyMenu line
+    std::map<std::string, std::string> hashes;
+    std::string result;
+    std::string::size_type start = 0;
+    while (start < menu.size())
+    {
+        std::string::size_type end = menu.find("\nDestroyMenu ", start);
+        end = (end == std::string::npos) ? menu.size() : end + 1;
+        std::string block = menu.substr(start, end - start);
+        start = end;
+        if (block.compare(0, 12, "DestroyMenu ") != 0)
+        {
+            result += block;
+            continue;
+        }
+        std::string name = menuName(block.substr(0, block.find('\n')));
+        std::ostringstream hash;
+        hash << std::hex << std::setw(16) << std::setfill('0') 
+            << MenuDigest::hash(block);
+        hashes[name] = hash.str();
+        std::map<std::string, std::string>::iterator it = oldState.find(name);
+        if (it == oldState.end() || it->second != hash.str()) result += block;
+    }
+    for (std::map<std::string, std::string>::iterator it = oldState.begin();
+            it != oldState.end(); it++)
+    {
+        if (hashes.find(it->first) == hashes.end())
+            result += "DestroyMenu \"" + it->first + "\"\n";
+    }
+
+    newState.clear();
+    for (std::map<std::string, std::string>::iterator it = hashes.begin();
+            it != hashes.end(); it++)
+        newState += it->second + ' ' + it->first + '\n';
+    return result;
+}
+
+/* Save the state returned by filter(). It is written to a temporary file 
+ * and renamed, so an interrupted save leaves the old state in place */
+bool FvwmDelta::saveState(const std::string& statePath, const std::string& newState)
+{
+    std::ostringstream tmpName;
+    tmpName << statePath << "." << getpid() << ".tmp";
+    std::string tmpPath = tmpName.str();
+    std::ofstream out_f(tmpPath.c_str(), std::ios::out | std::ios::trunc);
+    if (!out_f) return false;
+    out_f << newState;
+    out_f.close();
+    if (!out_f || rename(tmpPath.c_str(), statePath.c_str()) != 0)
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* Return the name of the menu destroyed by a DestroyMenu line, which is the 
+ * text between the first and last quotes */
+std::string FvwmDelta::menuName(const std::string& destroyLine)
+{
+    std::string::size_type first = destroyLine.find('"');
+    std::string::size_type last = destroyLine.rfind('"');
+    if (first == std::string::npos || last == first) return destroyLine;
+    return destroyLine.substr(first + 1, last - first - 1);
+}
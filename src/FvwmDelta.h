@@ -0,0 +1,45 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FVWM_DELTA_H_
+#define _FVWM_DELTA_H_
+
+#include <string>
+
+/* Cuts an FVWM menu down to the menus which changed since the last time a 
+ * menu was written with the same state file. Each menu in the output starts 
+ * with a DestroyMenu line. A hash of each menu is kept in the state file by 
+ * menu name, so unchanged menus can be left out and menus which have gone 
+ * can be destroyed. The new state is only saved once the cut down menu has 
+ * been written, so a failed write doesn't lose menus. The result can be piped into a running FVWM with 
+ * FvwmCommand or PipeRead */
+class FvwmDelta
+{
+    public:
+        static std::string filter(const std::string& menu, 
+                const std::string& statePath, std::string& newState);
+        static bool saveState(const std::string& statePath, 
+                const std::string& newState);
+
+    private:
+        static std::string menuName(const std::string& destroyLine);
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include "IconTheme.h"
+#include "DesktopFile.h"
+
+IconTheme::IconTheme(const std::string& root) :
+    root(root)
+{
+    while (this->root.size() > 1 && this->root[this->root.size() - 1] == '/')
+        this->root.erase(this->root.size() - 1);
+    name = this->root.substr(this->root.find_last_of("/") + 1);
+    parseIndex();
+}
+
+/* Read the Directories list and the per directory Size, MinSize, MaxSize,
+ * Threshold and Type keys from the index.theme file of the theme, if there is
+ * one. Missing keys get the defaults given by the icon theme specification */
+void IconTheme::parseIndex()
+{
+    std::ifstream index_f((root + "/index.theme").c_str());
+    if (!index_f) return;
+
+    std::string line;
+    std::string section;
+    std::vector<std::string> listed;
+    IconDirSpec spec;
+    int minSize = -1;
+    int maxSize = -1;
+    bool haveSize = false;
+
+    while (!index_f.eof())
+    {
+        getline(index_f, line);
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#') continue;
+        if (line[0] == '[')
+        {
+            if (haveSize)
+            {
+                spec.minSize = (minSize < 0) ? spec.size : minSize;
+                spec.maxSize = (maxSize < 0) ? spec.size : maxSize;
+                dirs[section] = spec;
+            }
+            section = line.substr(1, line.find(']') - 1);
+            spec.size = 0;
+            spec.threshold = 2;
+            spec.type = threshold;
+            minSize = -1;
+            maxSize = -1;
+            haveSize = false;
+            continue;
+        }
+        if (line.find('=') == std::string::npos ||
+                line.find('=') == line.size() - 1)
+            continue;
+        std::string id = DesktopFile::getID(line);
+        if (section == "Icon Theme")
+        {
+            if (id == "Directories" || id == "ScaledDirectories")
+            {
+                std::vector<std::string> values =
+                    DesktopFile::getMultiValue(line, ',');
+                listed.insert(listed.end(), values.begin(), values.end());
+            }
+            continue;
+        }
+        std::string value = DesktopFile::getSingleValue(line);
+        if (id == "Size")
+        {
+            spec.size = atoi(value.c_str());
+            haveSize = true;
+        }
+        else if (id == "MinSize") minSize = atoi(value.c_str());
+        else if (id == "MaxSize") maxSize = atoi(value.c_str());
+        else if (id == "Threshold") spec.threshold = atoi(value.c_str());
+        else if (id == "Type")
+        {
+            if (value == "Fixed") spec.type = fixed;
+            else if (value == "Scalable") spec.type = scalable;
+            else spec.type = threshold;
+        }
+    }
+    if (haveSize)
+    {
+        spec.minSize = (minSize < 0) ? spec.size : minSize;
+        spec.maxSize = (maxSize < 0) ? spec.size : maxSize;
+        dirs[section] = spec;
+    }
+    index_f.close();
+
+    //Only directories named by the Directories key are part of the theme
+    if (!listed.empty())
+    {
+        std::map<std::string, IconDirSpec>::iterator it = dirs.begin();
+        while (it != dirs.end())
+        {
+            if (find(listed.begin(), listed.end(), it->first) == listed.end())
+                dirs.erase(it++);
+            else
+                it++;
+        }
+    }
+}
+
+/* Find the directory spec for the directory an icon lives in. If the theme
+ * has no index.theme or the directory isn't listed in it, try and work it
+ * out from the directory name instead */
+bool IconTheme::findSpec(const std::string& iconPath, IconDirSpec& spec)
+{
+    if (iconPath.size() <= root.size() + 1 ||
+            iconPath.compare(0, root.size(), root) != 0)
+        return false;
+    std::string subdir = iconPath.substr(root.size() + 1);
+    if (subdir.find_last_of("/") == std::string::npos) return false;
+    subdir.erase(subdir.find_last_of("/"));
+
+    std::map<std::string, IconDirSpec>::iterator it = dirs.find(subdir);
+    if (it != dirs.end())
+    {
+        spec = it->second;
+        return true;
+    }
+    return guessSpec(subdir, spec);
+}
+
+/* Guess a spec from a directory name like 48x48/apps or scalable/apps. The 
+ * size directory is looked for in every part of the name, so icons are 
+ * scored by the directory they are in even when the root given isn't the 
+ * theme's own */
+bool IconTheme::guessSpec(const std::string& subdir, IconDirSpec& spec)
+{
+    std::string::size_type start = 0;
+    while (start <= subdir.size())
+    {
+        std::string::size_type end = subdir.find("/", start);
+        if (end == std::string::npos) end = subdir.size();
+        std::string part = subdir.substr(start, end - start);
+        start = end + 1;
+        if (part == "scalable")
+        {
+            spec.size = 128;
+            spec.minSize = 1;
+            spec.maxSize = 512;
+            spec.threshold = 2;
+            spec.type = scalable;
+            return true;
+        }
+        std::string::size_type x = part.find("x");
+        if (x == std::string::npos || x == 0) continue;
+        int size = atoi(part.substr(0, x).c_str());
+        if (size <= 0) continue;
+        spec.size = size;
+        spec.minSize = size;
+        spec.maxSize = size;
+        spec.threshold = 2;
+        spec.type = threshold;
+        return true;
+    }
+    return false;
+}
+
+/* Return how far an icon is from the requested size, using the
+ * DirectorySizeDistance algorithm from the icon theme specification. 0 means
+ * the icon is a match. Icons in directories we know nothing about get
+ * ICON_DISTANCE_UNKNOWN so they are only chosen if there is nothing better */
+int IconTheme::distance(const std::string& iconPath, int iconSize)
+{
+    IconDirSpec spec;
+    if (!findSpec(iconPath, spec)) return ICON_DISTANCE_UNKNOWN;
+    switch (spec.type)
+    {
+        case fixed:
+            return abs(spec.size - iconSize);
+        case scalable:
+            if (iconSize < spec.minSize) return spec.minSize - iconSize;
+            if (iconSize > spec.maxSize) return iconSize - spec.maxSize;
+            return 0;
+        case threshold:
+            if (iconSize < spec.size - spec.threshold)
+                return spec.size - spec.threshold - iconSize;
+            if (iconSize > spec.size + spec.threshold)
+                return iconSize - spec.size - spec.threshold;
+            return 0;
+    }
+    return ICON_DISTANCE_UNKNOWN;
+}
+
+/* Return true if an icon lives in a scalable directory. Used to prefer
+ * bitmaps over svgs of the same distance as they are cheaper to load */
+bool IconTheme::isScalable(const std::string& iconPath)
+{
+    IconDirSpec spec;
+    if (findSpec(iconPath, spec)) return spec.type == scalable;
+    return iconPath.size() > 4 &&
+        iconPath.substr(iconPath.size() - 4, 4) == ".svg";
+}
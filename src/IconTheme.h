@@ -0,0 +1,64 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ICON_THEME_H_
+#define _ICON_THEME_H_
+
+#include <string>
+#include <map>
+
+//Icon directory types as defined in the icon theme specification
+enum IconDirType
+{
+    fixed = 0,
+    scalable,
+    threshold
+};
+
+struct IconDirSpec
+{   int size;
+    int minSize;
+    int maxSize;
+    int threshold;
+    IconDirType type;
+};
+
+#define ICON_DISTANCE_UNKNOWN 100000
+
+class IconTheme
+{
+    public:
+        IconTheme(const std::string& root);
+
+        std::string root;
+        std::string name;
+
+        int distance(const std::string& iconPath, int iconSize);
+        bool isScalable(const std::string& iconPath);
+
+    private:
+        std::map<std::string, IconDirSpec> dirs;
+
+        void parseIndex();
+        bool findSpec(const std::string& iconPath, IconDirSpec& spec);
+        static bool guessSpec(const std::string& subdir, IconDirSpec& spec);
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include "MenuDigest.h"
+
+/* Write a menu to a file unless the same menu was written there last time. 
+ * Returns MENU_WRITTEN, MENU_UNCHANGED or MENU_FAILED */
+int MenuDigest::update(const std::string& path, const std::string& menu)
+{
+    std::string stored;
+    std::ifstream digest_f(digestPath(path).c_str());
+    if (digest_f) getline(digest_f, stored);
+    digest_f.close();
+    if (stored != "" && stored == digest(path, menu)) return MENU_UNCHANGED;
+
+    std::ofstream menu_f(path.c_str());
+    if (!menu_f) return MENU_FAILED;
+    menu_f << menu;
+    menu_f.close();
+    if (!menu_f) return MENU_FAILED;
+
+    //A digest which can't be saved only means the menu is written next time
+    std::ofstream out_f(digestPath(path).c_str());
+    if (out_f) out_f << digest(path, menu) << std::endl;
+    return MENU_WRITTEN;
+}
+
+/* Return the path of the digest kept for a menu file */
+std::string MenuDigest::digestPath(const std::string& path)
+{
+    boost::filesystem::path p(path);
+    return (p.parent_path() / ("." + p.filename().string() + ".digest")).string();
+}
+
+/* Return the digest for a menu as written to a file, which is a 64 bit 
+ * FNV-1a hash of the menu followed by the size and modification time of the
+ * file. If the file doesn't exist, the digest is empty */
+std::string MenuDigest::digest(const std::string& path, const std::string& menu)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return "";
+    std::ostringstream result;
+    result << std::hex << std::setw(16) << std::setfill('0') << hash(menu) << std::dec 
+        << " " << menu.size() << " " << st.st_size << " " << st.st_mtime;
+    return result.str();
+}
+
+//64 bit FNV-1a
+uint64_t MenuDigest::hash(const std::string& data)
+{
+    uint64_t hash = 0xcbf29ce484222325ul;
+    for (unsigned int x = 0; x < data.size(); x++)
+    {
+        hash ^= (unsigned char)data[x];
+        hash *= 0x100000001b3ul;
+    }
+    return hash;
+}
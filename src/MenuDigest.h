@@ -0,0 +1,49 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_DIGEST_H_
+#define _MENU_DIGEST_H_
+
+#include <string>
+#include <stdint.h>
+
+//Results of MenuDigest::update
+#define MENU_WRITTEN 0
+#define MENU_UNCHANGED 1
+#define MENU_FAILED 2
+
+/* Writes a menu file only if it has changed. A digest of the menu, with the 
+ * size and modification time of the file it was written to, is kept in a 
+ * hidden file next to it, e.g. ~/.fvwm/.menu.digest for ~/.fvwm/menu. The 
+ * file is written if the digest is missing or differs, or if the file has 
+ * been changed or removed since, so window managers only need reloading 
+ * when the menu really changed */
+class MenuDigest
+{
+    public:
+        static int update(const std::string& path, const std::string& menu);
+        static std::string digestPath(const std::string& path);
+        static uint64_t hash(const std::string& data);
+
+    private:
+        static std::string digest(const std::string& path, const std::string& menu);
+};
+
+#endif
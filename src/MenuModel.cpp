@@ -0,0 +1,561 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "boost/filesystem.hpp"
+#include "MenuModel.h"
+#include "DesktopFile.h"
+#include "MenuWriter.h"
+#include "Category.h"
+#include "IconTheme.h"
+#include "Snapshot.h"
+#include "ParseCache.h"
+#include "ExecIndex.h"
+#include "XdgDirs.h"
+#include "MenuDigest.h"
+#include "FvwmDelta.h"
+#include "SearchIndex.h"
+#include "AllocStats.h"
+
+#define WRITER_ARGS out, config, windowmanager, useIcons, *tree, entries
+
+MenuModel::MenuModel() :
+    tree(NULL)
+{
+}
+
+MenuModel::~MenuModel()
+{
+    clear();
+}
+
+/* Drop the categories, entries and layout, so the model can be built or 
+ * loaded again */
+void MenuModel::clear()
+{
+    delete tree;
+    tree = NULL;
+    for (unsigned int x = 0; x < cats.size(); x++) delete cats[x];
+    cats.clear();
+    entries = EntryTable();
+}
+
+//Function that attempts to get the user icon theme from ~/.gtkrc-2.0
+static std::string getIconTheme(const std::string& homedir)
+{
+    std::ifstream themefile;
+    std::string path = homedir + "/.gtkrc-2.0";
+    std::string id = "gtk-icon-theme-name";
+    themefile.open(path.c_str());
+    if (!themefile) return "";
+    else
+    {
+        std::string line;
+        while (!themefile.eof())
+        {
+            getline(themefile, line);
+            std::string read_id = DesktopFile::getID(line);
+            if (id == read_id)
+            {
+                std::string themename = DesktopFile::getSingleValue(line);
+                return themename;
+            }
+        }
+        themefile.close();
+        return "";
+    }
+}
+
+//A function to make sure we only add unique categories to the categories list.
+//The list owns the category afterwards, so one which isn't kept is deleted
+static void addCategory(Category *c, std::vector<Category*> &categories)
+{  
+    for (unsigned int x = 0; x < categories.size(); x++) 
+    {
+        if (categories[x]->name == c->name)
+        {
+            //Replace default category object with custom object of the same
+            //name if the definitions differ
+            if (!c->getIncludes().empty() || !c->getExcludes().empty() || 
+                    (c->icon != categories[x]->icon && c->icon != "")) 
+            {
+                delete categories[x];
+                categories[x] = c;
+            }
+            else delete c;
+            return;
+        }
+    }
+    categories.push_back(c);
+}
+
+//A function to add an id (meaning a base filename - no full path) to a list
+//if it isn't already present in the list. Return true if we add the item
+//and false if we do not because it's already in the list. This is useful for 
+//local overrides for XDG desktop entries and icons.
+static bool addID(const std::string& path, NameSet& ids)
+{  
+    return ids.insert(boost::filesystem::path(path).stem().string()).second;
+}
+
+/* Scan the desktop entry, icon and category locations and build the 
+ * categorised model from what is found. Anything already in the model is 
+ * dropped first */
+void MenuModel::build(const RunConfig& config)
+{
+    ALLOC_PHASE(phaseScan);
+    clear();
+    //Directory listings and the values read from desktop entries are cached
+    //between runs, so only what has changed needs to be read again
+    ParseCache cache(ParseCache::defaultPath(config.homedir), config.useCache);
+    //The programs in $PATH, for checking TryExec and Exec
+    ExecIndex execIndex(&cache);
+    //Desktop entries, icons and categories are looked for under the XDG 
+    //base directories
+    XdgDirs xdg(config.homedir);
+
+    //Get std::string std::vector of paths to .desktop files
+    std::vector<std::string> paths;
+    NameSet pathIDS;
+    paths.reserve(300);
+    std::vector<std::string> appdirs;
+    appdirs.insert(appdirs.end(), config.extraDesktopPaths.begin(), 
+            config.extraDesktopPaths.end());
+    std::vector<std::string> xdgAppdirs = xdg.dataPaths("applications");
+    appdirs.insert(appdirs.end(), xdgAppdirs.begin(), xdgAppdirs.end());
+    appdirs = XdgDirs::uniqueRoots(appdirs);
+    for (unsigned int x = 0; x < appdirs.size(); x++)
+    {   
+        std::vector<std::string> found;
+        cache.listFiles(appdirs[x], found);
+        for (unsigned int y = 0; y < found.size(); y++)
+        {
+            std::string thePath = found[y];
+            if (thePath.size() > 8 && 
+                    thePath.substr(thePath.size() - 8, 8) == ".desktop" &&
+                    addID(thePath, pathIDS)) 
+                paths.push_back(thePath);
+        }
+    }
+    //The entries are in order of precedence, so those past the limit are the
+    //ones dropped
+    if (paths.size() > config.limits.maxEntries)
+    {
+        std::cerr << "mwmmenu: skipping " << 
+            paths.size() - config.limits.maxEntries << " desktop entries over "
+            "the limit of " << config.limits.maxEntries << std::endl;
+        paths.resize(config.limits.maxEntries);
+    }
+
+    //Get std::string std::vector of paths to icons
+    ALLOC_PHASE(phaseIcons);
+    std::vector<IconSpec> iconpaths;
+    if (config.useIcons)
+    {   
+        iconpaths.reserve(500);
+        std::vector<std::string> icondirs;
+        if (!config.iconsXdgOnly)
+            icondirs.insert(icondirs.end(), config.extraIconPaths.begin(), 
+                    config.extraIconPaths.end());
+        icondirs.push_back(config.homedir + "/.icons/hicolor");
+        icondirs.push_back(xdg.dataHome + "/icons/hicolor");
+        //Without a theme of the user's, the default theme is used, as the 
+        //icon theme spec says. icons/ on its own would be the whole icons 
+        //root, which would hide the hicolor directories inside it
+        std::string themename = getIconTheme(config.homedir); 
+        if (themename == "") themename = "hicolor";
+        std::vector<std::string> xdgIcondirs = 
+            xdg.systemDataPaths("icons/" + themename);
+        icondirs.insert(icondirs.end(), xdgIcondirs.begin(), xdgIcondirs.end());
+        if (themename != "hicolor")
+        {
+            xdgIcondirs = xdg.systemDataPaths("icons/hicolor");
+            icondirs.insert(icondirs.end(), xdgIcondirs.begin(), 
+                    xdgIcondirs.end());
+        }
+        if (!config.iconsXdgOnly) 
+        {   
+            xdgIcondirs = xdg.systemDataPaths("pixmaps");
+            icondirs.insert(icondirs.end(), xdgIcondirs.begin(), 
+                    xdgIcondirs.end());
+        }
+        icondirs = XdgDirs::uniqueRoots(icondirs);
+        //If a nominal icon size has been requested, read the index.theme of 
+        //each icon directory so we can work out how close each icon is to 
+        //that size. Directories of the same theme (e.g. the user and system 
+        //hicolor directories) are treated as one group
+        std::vector<IconTheme> themes;
+        std::vector<unsigned int> themeGroups;
+        if (config.iconSize > 0)
+        {
+            for (unsigned int x = 0; x < icondirs.size(); x++)
+            {
+                themes.push_back(IconTheme(icondirs[x]));
+                unsigned int group = x;
+                for (unsigned int y = 0; y < x; y++)
+                {
+                    if (themes[y].name == themes[x].name &&
+                            icondirs[x].find("/icons/") != std::string::npos)
+                    {
+                        group = themeGroups[y];
+                        break;
+                    }
+                }
+                themeGroups.push_back(group);
+            }
+        }
+        //If an xdg icon size has been specified, limit the icon search to the 
+        //appropriate directory
+        if (config.iconsXdgSize != "/")
+        { 
+            for (unsigned int x = 0; x < icondirs.size(); x++)
+            { 
+                if (icondirs[x].find("/share/icons/") != std::string::npos)
+                    icondirs[x] = icondirs[x] + "/" + config.iconsXdgSize;
+            }
+        }
+        /* Walk the icon directories. Without a nominal size, the first icon 
+         * found for an id wins. With one, an icon found later in the same 
+         * theme group replaces it if it is closer to the requested size, or
+         * equally close but a bitmap rather than an svg */
+        std::map<std::string, unsigned int> iconIndex;
+        std::vector<int> iconDistances;
+        std::vector<bool> iconScalable;
+        std::vector<unsigned int> iconGroups;
+        for (unsigned int x = 0; x < icondirs.size(); x++)
+        {   
+            std::vector<std::string> iconFiles;
+            cache.listFiles(icondirs[x], iconFiles);
+            for (unsigned int z = 0; z < iconFiles.size(); z++)
+            {   
+                std::string ipath = iconFiles[z];
+                IconSpec spec;
+                spec.path = ipath;
+                spec.id = boost::filesystem::path(ipath).stem().string();
+                spec.def = 
+                    spec.id.substr(spec.id.find_last_of("/") + 1, 
+                    spec.id.find_last_of(".") - 
+                    spec.id.find_last_of("/") - 1);
+                int distance = 0;
+                bool scalable = false;
+                if (config.iconSize > 0)
+                {
+                    distance = themes[x].distance(ipath, config.iconSize);
+                    scalable = themes[x].isScalable(ipath);
+                }
+                std::map<std::string, unsigned int>::iterator found =
+                    iconIndex.find(spec.id);
+                if (found == iconIndex.end())
+                {
+                    iconIndex[spec.id] = iconpaths.size();
+                    iconpaths.push_back(spec);
+                    iconDistances.push_back(distance);
+                    iconScalable.push_back(scalable);
+                    iconGroups.push_back(config.iconSize > 0 ? themeGroups[x] : 0);
+                    continue;
+                }
+                unsigned int y = found->second;
+                if (config.iconSize <= 0 || iconGroups[y] != themeGroups[x]) 
+                    continue;
+                if (distance < iconDistances[y] || 
+                        (distance == iconDistances[y] && 
+                        iconScalable[y] && !scalable))
+                {
+                    iconpaths[y] = spec;
+                    iconDistances[y] = distance;
+                    iconScalable[y] = scalable;
+                }
+            }
+        }
+    }
+
+    ALLOC_PHASE(phaseCategories);
+    /* Create categories
+     * Note that for baseCategories we combine Audio, Video and AudioVideo 
+     * into Multimedia. We also rename Network to Internet and Utility to 
+     * Accessories as this is what is commonly done elsewhere. Otherwise, our 
+     * categories are the same as the freedesktop.org base categories */
+    const char *baseCatsArr[] = {"Accessories", "Development", "Education",
+        "Game", "Graphics", "Multimedia", "Internet", "Office", "Other",
+        "Science", "Settings", "System"};
+    std::vector<std::string> baseCategories(baseCatsArr, 
+            baseCatsArr + sizeof(baseCatsArr) / sizeof(*baseCatsArr));
+    std::vector<std::string> catPaths;
+    catPaths.reserve(10);
+    std::vector<std::string> menuPaths;
+    menuPaths.reserve(10);
+    if (!config.noCustomCats)
+    {   
+        //Later custom categories replace earlier ones of the same name, so 
+        //these are walked from the lowest precedence directory to the highest
+        std::vector<std::string> catDirs = 
+            XdgDirs::uniqueRoots(xdg.dataPaths("desktop-directories"));
+        reverse(catDirs.begin(), catDirs.end());
+        std::vector<std::string> menuDirs;
+        menuDirs.push_back(xdg.configHome + "/menus/applications-merged");
+        for (unsigned int x = 0; x < xdg.configDirs.size(); x++)
+            menuDirs.push_back(xdg.configDirs[x] + "/menus/applications-merged");
+        menuDirs = XdgDirs::uniqueRoots(menuDirs);
+        reverse(menuDirs.begin(), menuDirs.end());
+        for (unsigned int x = 0; x < catDirs.size(); x++)
+        {
+            std::vector<std::string> found;
+            cache.listFiles(catDirs[x], found);
+            for (unsigned int y = 0; y < found.size(); y++)
+            {
+                std::string thePath = found[y];
+                if (thePath.size() > 10 &&
+                        thePath.substr(thePath.size() - 10, 19) == ".directory")
+                    catPaths.push_back(thePath);
+            }
+        }
+        for (unsigned int x = 0; x < menuDirs.size(); x++)
+        {   
+            std::vector<std::string> found;
+            cache.listFiles(menuDirs[x], found);
+            for (unsigned int y = 0; y < found.size(); y++)
+            {
+                std::string thePath = found[y];
+                if (thePath.size() > 5 && 
+                        thePath.substr(thePath.size() - 5, 5) == ".menu")
+                    menuPaths.push_back(thePath);
+            }
+        }
+    }
+    cats.reserve(20);
+    //Create the base categories
+    for (unsigned int x = 0; x < baseCategories.size(); x++)
+    {   
+        Category *c = new Category(baseCategories[x], config.useIcons, iconpaths, 
+                config.iconsXdgSize, config.iconsXdgOnly);
+        cats.push_back(c);
+    }
+    //Create the custom categories (if there are any)
+    for (unsigned int x = 0; x < catPaths.size(); x++)
+    {   
+        Category *c = new Category(catPaths[x].c_str(), menuPaths, config.useIcons, 
+                iconpaths, config.iconsXdgSize, config.iconsXdgOnly, config.limits);
+        if (c->name != "") addCategory(c, cats);
+        else delete c;
+    }
+    sort(cats.begin(), cats.end(), myCompare<Category>);
+    //If only one category is wanted, drop the others so entries are only
+    //matched against it. Other is the exception, as whether an entry belongs
+    //to it depends on all the other categories
+    if (config.onlyCategory != "" && config.onlyCategory != "Other")
+    {
+        std::vector<Category*> wanted;
+        for (unsigned int x = 0; x < cats.size(); x++)
+        {
+            if (cats[x]->name == config.onlyCategory) wanted.push_back(cats[x]);
+            else delete cats[x];
+        }
+        cats = wanted;
+    }
+
+    //Read each desktop entry and add it to the entry table, which associates 
+    //it with the appropriate categories. Category names need ids in the 
+    //table first
+    for (unsigned int x = 0; x < cats.size(); x++) cats[x]->internNames(entries);
+    ALLOC_PHASE(phaseParse);
+    std::vector<DesktopFile*> files = DesktopFile::readAll(paths, &cache, 
+            config.ioUring, config.limits);
+    DesktopFile::hideUnavailable(files, config, &execIndex);
+    if (!config.keepDuplicates) DesktopFile::dedupe(files);
+    for (unsigned int x = 0; x < files.size(); x++)
+    {   
+        files[x]->addTo(entries, cats, config, iconpaths);
+        delete files[x];
+    }
+    cache.save();
+}
+
+/* Load a model saved with save() instead of building one. Anything already
+ * in the model is dropped first. Return false if it can't be loaded */
+bool MenuModel::load(const std::string& path)
+{
+    ALLOC_PHASE(phaseParse);
+    clear();
+    return Snapshot::load(path, cats, entries);
+}
+
+/* Save the model, before it is filtered. Return false if it can't be saved */
+bool MenuModel::save(const std::string& path) const
+{
+    return Snapshot::save(path, cats, entries);
+}
+
+/* Apply the filters, terminal, category and page size from the options to 
+ * the model and lay out the categories to be written. This is done once, 
+ * after which the model can be rendered any number of times, so later calls
+ * do nothing until the model is built or loaded again */
+void MenuModel::filter(const RunConfig& config)
+{
+    if (tree != NULL) return;
+    ALLOC_PHASE(phaseFilter);
+    entries.setTerminal(config.term);
+    MenuWriter::filterCategories(cats, entries, config);
+    std::vector<Category*> usedCats;
+    for (unsigned int x = 0; x < cats.size(); x++)
+    {
+        if (cats[x]->nodisplay) continue;
+        if (config.onlyCategory == "" || cats[x]->name == config.onlyCategory) 
+            usedCats.push_back(cats[x]);
+    }
+    //Split oversized categories in the model, so every format writes the 
+    //same pages
+    if (config.maxItems > 0)
+    {
+        for (unsigned int x = 0; x < usedCats.size(); x++)
+            usedCats[x]->paginate(entries, config.maxItems);
+    }
+    delete tree;
+    tree = new CategoryTree(usedCats, entries);
+}
+
+/* Write the menu for a window manager to a stream. Return false, writing 
+ * nothing, if the model hasn't been filtered */
+bool MenuModel::render(std::ostream& out, const RunConfig& config,
+        WindowManager windowmanager) const
+{
+    if (tree == NULL) return false;
+    ALLOC_PHASE(phaseRender);
+    bool useIcons = config.useIcons && RunConfig::supportsIcons(windowmanager);
+    switch (windowmanager)
+    {
+        case mwm:
+        {
+            MwmMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+        case fvwm:
+        case fvwm_dynamic:
+        {
+            FvwmMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+        case fluxbox:
+        {
+            FluxboxMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+        case openbox:
+        case openbox_pipe:
+        {
+            OpenboxMenuWriter writer(WRITER_ARGS, config.pipeCommand, 
+                    config.onlyCategory != "");
+            writer.write();
+            break;
+        }
+        case olvwm:
+        {
+            OlvwmMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+        case windowmaker:
+        {
+            WmakerMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+        case icewm:
+        {
+            IcewmMenuWriter writer(WRITER_ARGS);
+            writer.write();
+            break;
+        }
+    }
+    return true;
+}
+
+/* Return the menu for a window manager as a string, which is empty if the 
+ * model hasn't been filtered */
+std::string MenuModel::render(const RunConfig& config, 
+        WindowManager windowmanager) const
+{
+    std::ostringstream menu;
+    render(menu, config, windowmanager);
+    return menu.str();
+}
+
+/* Write the menu for a window manager to a file, or to standard output if 
+ * the path is -, as asked for by --emit, --if-changed and --delta. Returns 
+ * MENU_WRITTEN, MENU_UNCHANGED or MENU_FAILED */
+int MenuModel::emit(const RunConfig& config, WindowManager windowmanager, 
+        const std::string& path) const
+{
+    if (tree == NULL) return MENU_FAILED;
+    if (config.deltaState == "" && (!config.ifChanged || path == "-"))
+    {
+        //A full disk or a closed pipe only shows in the stream's state
+        if (path == "-")
+        {
+            render(std::cout, config, windowmanager);
+            std::cout.flush();
+            return std::cout ? MENU_WRITTEN : MENU_FAILED;
+        }
+        std::ofstream menuFile(path.c_str());
+        if (!menuFile) return MENU_FAILED;
+        render(menuFile, config, windowmanager);
+        menuFile.close();
+        return menuFile ? MENU_WRITTEN : MENU_FAILED;
+    }
+
+    //Menus which are cut down to the changes or compared with the last one 
+    //are made in memory first
+    std::string text = render(config, windowmanager);
+    std::string deltaState;
+    if (config.deltaState != "") 
+        text = FvwmDelta::filter(text, config.deltaState, deltaState);
+    int status;
+    if (path == "-")
+    {
+        std::cout << text << std::flush;
+        status = std::cout ? MENU_WRITTEN : MENU_FAILED;
+    }
+    else if (config.ifChanged) status = MenuDigest::update(path, text);
+    else
+    {
+        std::ofstream menuFile(path.c_str());
+        menuFile << text;
+        menuFile.close();
+        status = menuFile ? MENU_WRITTEN : MENU_FAILED;
+    }
+    //The delta state describes what the reader has now, so it can only move
+    //on once the menu has reached them
+    if (config.deltaState != "" && status != MENU_FAILED)
+        FvwmDelta::saveState(config.deltaState, deltaState);
+    return status;
+}
+
+/* Write the entries in the menu as a search index for launchers. Return 
+ * false if it can't be saved or the model hasn't been filtered */
+bool MenuModel::saveSearchIndex(const std::string& path) const
+{
+    if (tree == NULL) return false;
+    ALLOC_PHASE(phaseRender);
+    return SearchIndex::save(path, *tree, entries);
+}
@@ -0,0 +1,68 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_MODEL_H_
+#define _MENU_MODEL_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "Category.h"
+#include "CategoryTree.h"
+#include "EntryTable.h"
+#include "RunConfig.h"
+
+/* The categorised menu model and the steps mwmmenu takes with it, so that 
+ * other programs can link libmwmmenu and make menus without running 
+ * mwmmenu. The options are given as a RunConfig, which can be made from an 
+ * argument list in the same form mwmmenu takes. A model is built (scanning 
+ * the desktop entry locations) or loaded, filtered once, then rendered for 
+ * as many window managers as needed. Building or loading again starts a 
+ * new model, and rendering needs a filtered model */
+class MenuModel
+{
+    public:
+        MenuModel();
+        ~MenuModel();
+
+        std::vector<Category*> cats;
+        EntryTable entries;
+
+        void build(const RunConfig& config);
+        bool load(const std::string& path);
+        bool save(const std::string& path) const;
+        void filter(const RunConfig& config);
+        bool render(std::ostream& out, const RunConfig& config, 
+                WindowManager windowmanager) const;
+        std::string render(const RunConfig& config, 
+                WindowManager windowmanager) const;
+        int emit(const RunConfig& config, WindowManager windowmanager, 
+                const std::string& path) const;
+        bool saveSearchIndex(const std::string& path) const;
+
+    private:
+        CategoryTree *tree;
+
+        void clear();
+        MenuModel(const MenuModel&);
+        MenuModel& operator=(const MenuModel&);
+};
+
+#endif
@@ -22,143 +22,134 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <pthread.h>
 #include <boost/algorithm/string/replace.hpp>
 #include "MenuWriter.h"
 #include "Category.h"
+#include "Escape.h"
 
 //------------------------------------------------------------------------------
 
 MenuWriter::MenuWriter(WRITER_CONSTRUCT) :
-    cats(cats),
-    menuName(menuName),
+    out(out),
+    config(config),
     windowmanager(windowmanager),
     useIcons(useIcons),
-    exclude(exclude),
-    excludeMatching(excludeMatching),
-    excludeCategories(excludeCategories),
-    include(include),
-    excludedFilenames(excludedFilenames)
+    tree(tree),
+    entries(entries),
+    usedCats(tree.roots())
 {   
-    entryDisplayHandler();
+}
 
-    //Get the used categories
-    for (unsigned int x = 0; x < cats.size(); x++)
-    { 
-        if (categoryNotExcluded(cats[x])) 
-        {
-            usedCats.push_back(cats[x]);
-        }
-    }
+/* Write the menu to out. Most formats are just their top level categories, 
+ * those with a main menu or pipe menus add to this */
+void MenuWriter::write()
+{
+    writeMenus();
 }
 
-/* Function to filter out desktop entries specified from the command line
- * based on various criteria. The entries are excluded simply by setting the
- * nodisplay value to true */
-void MenuWriter::entryDisplayHandler()
+/* Apply the command line filters to the categories and their entries. The 
+ * entries are excluded simply by setting the nodisplay value to true. The 
+ * entry filters are applied in one pass over the entry table rather than once
+ * per category. This only needs to be done once, however many menus are 
+ * written from the result */
+void MenuWriter::filterCategories(const std::vector<Category*>& cats,
+        EntryTable& entries, const RunConfig& config)
 {  
-    for (unsigned int w = 0; w < cats.size(); w++)
+    if (config.filtersEntries())
     {
-        std::vector<DesktopFile*> files = cats[w]->getEntriesR();
-        if (!exclude.empty())
-        {   
-            for (unsigned int x = 0; x < files.size(); x++)
-                if (find(exclude.begin(), exclude.end(), files[x]->name) != 
-                        exclude.end()) 
-                    files[x]->nodisplay = true;
-        }
-        if (!excludeMatching.empty())
+        for (unsigned int x = 0; x < entries.size(); x++)
         {
-            for (unsigned int x = 0; x < files.size(); x++)
-            {
-                for (unsigned int y = 0; y < excludeMatching.size(); y++)
-                {
-                    if (files[x]->name.find(excludeMatching[y]) != std::string::npos)
-                    {
-                        files[x]->nodisplay = true;
-                        break;
-                    }
-                }
-            }
-        }
-        if (!excludedFilenames.empty())
-        {   
-            for (unsigned int x = 0; x < files.size(); x++)
-                if (find(excludedFilenames.begin(), excludedFilenames.end(), 
-                        files[x]->filename) != excludedFilenames.end()) 
-                    files[x]->nodisplay = true;
+            std::string name = entries.name(x);
+            if (config.entryExcluded(name, entries.filename(x)))
+                entries.setNodisplay(x, true);
+            if (config.entryIncluded(name)) 
+                entries.setNodisplay(x, false);
         }
-        if (!include.empty())
-        {   
-            for (unsigned int x = 0; x < files.size(); x++)
-                if (find(include.begin(), include.end(), files[x]->name) != 
-                        include.end()) 
-                    files[x]->nodisplay = false;
+    }
+    if (config.excludeCategories.empty()) return;
+    for (unsigned int w = 0; w < cats.size(); w++)
+    {
+        if (config.excludeCategories.count(cats[w]->name))
+        {
+            cats[w]->nodisplay = true;
+            continue;
         }
-        if (!excludeCategories.empty())
+        std::vector<Category*> subCats = cats[w]->getSubcatsR();
+        for (unsigned int x = 0; x < subCats.size(); x++)
         {
-            if (find(excludeCategories.begin(), excludeCategories.end(),
-                    cats[w]->name) != excludeCategories.end())
-            {
-                cats[w]->nodisplay = true;
-                continue;
-            }
-            std::vector<Category*> subCats = cats[w]->getSubcatsR();
-            for (unsigned int x = 0; x < subCats.size(); x++)
-            {
-                Category *subCat = subCats[x];
-                if (find(excludeCategories.begin(), excludeCategories.end(),
-                        subCat->name) != excludeCategories.end())
-                {
-                    subCat->nodisplay = true;
-                }
-            }
+            if (config.excludeCategories.count(subCats[x]->name))
+                subCats[x]->nodisplay = true;
         }
     }
 }
 
-/* A function to check whether a category is not present in the list of 
- * excluded categories and also whether a category has any non-hidden desktop 
- * files. If so, return true, otherwise return false */
-bool MenuWriter::categoryNotExcluded(Category* c)
-{   
-    if (c->nodisplay) return false;
-    bool visibleFound = false;
-    std::vector<Category*> cats = c->getSubcatsR();
-    cats.push_back(c);
-    for (unsigned int x = 0; x < cats.size(); x++)
+/* The top level categories left to write and a buffer for each, shared by 
+ * the threads writing them */
+struct MenuQueue
+{   MenuWriter *writer;
+    const std::vector<unsigned int> *cats;
+    std::vector<std::string> buffers;
+    unsigned int next;
+    pthread_mutex_t lock;
+};
+
+/* Write each top level category. With more than one job, the categories are
+ * shared out between threads which write them into separate buffers, and 
+ * the buffers are written out in order once all the threads are done. A 
+ * category is written the same way whichever thread writes it, so the menu 
+ * does not change */
+void MenuWriter::writeMenus()
+{
+    unsigned int jobs = std::min((unsigned int)config.jobs, 
+            (unsigned int)usedCats.size());
+    if (jobs <= 1)
     {
-        Category *subCat = cats[x];
-        if (subCat->nodisplay) continue;
-        std::vector<DesktopFile*> entries = subCat->getEntries();
-        for (unsigned int y = 0; y < entries.size(); y++)
-        {
-            if (entries[y]->nodisplay == false)
-            {
-                visibleFound = true;
-                break;
-            }
-        }
+        for (unsigned int x = 0; x < usedCats.size(); x++) 
+            writeMenu(out, usedCats[x], x, usedCats.size() - 1);
+        return;
     }
-    if (!visibleFound) return false;
-    return true;
-}
 
-/* This function returns the number of visible entries per category */
-int MenuWriter::realNumEntries(std::vector<DesktopFile*> entries)
-{
-    int size = 0;
-    for (unsigned int x = 0; x < entries.size(); x++)
-        if (!entries[x]->nodisplay) size++;
-    return size;
+    MenuQueue queue;
+    queue.writer = this;
+    queue.cats = &usedCats;
+    queue.buffers.resize(usedCats.size());
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+    //This thread writes categories too, so if a thread can't be started 
+    //the rest still get written
+    std::vector<pthread_t> threads;
+    for (unsigned int x = 1; x < jobs; x++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, writeMenusThread, &queue) != 0) break;
+        threads.push_back(thread);
+    }
+    writeMenusThread(&queue);
+    for (unsigned int x = 0; x < threads.size(); x++) 
+        pthread_join(threads[x], NULL);
+    pthread_mutex_destroy(&queue.lock);
+
+    for (unsigned int x = 0; x < queue.buffers.size(); x++) 
+        out << queue.buffers[x];
 }
 
-/* This function returns the number of visible subcategories per category */
-int MenuWriter::realNumCats(std::vector<Category*> cats)
+/* Take categories from the queue and write them until there are none left */
+void *MenuWriter::writeMenusThread(void *queue)
 {
-    int size = 0;
-    for (unsigned int x = 0; x < cats.size(); x++)
-        if (categoryNotExcluded(cats[x])) size++;
-    return size;
+    MenuQueue *q = static_cast<MenuQueue*>(queue);
+    while (true)
+    {
+        pthread_mutex_lock(&q->lock);
+        unsigned int x = q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (x >= q->cats->size()) break;
+        std::ostringstream buffer;
+        q->writer->writeMenu(buffer, (*q->cats)[x], x, q->cats->size() - 1);
+        q->buffers[x] = buffer.str();
+    }
+    return NULL;
 }
 
 //------------------------------------------------------------------------------
@@ -167,44 +158,56 @@ int MenuWriter::realNumCats(std::vector<Category*> cats)
 
 MwmMenuWriter::MwmMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
+}
+
+void MwmMenuWriter::write()
+{
+    writeMenus();
     if (!usedCats.empty()) writeMainMenu();
 }
 
-void MwmMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void MwmMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
-    std::cout << "menu \"" << cat->name << '"' << std::endl << "{" << std::endl;
-    std::cout << "    \"" << cat->name << "\" " << "f.title" << std::endl;
-    for (unsigned int x = 0; x < subCats.size(); x++)
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
+    out << "menu \"" << Escape(tree.name(cat), escapeQuoted) << '"' << 
+        std::endl << "{" << std::endl;
+    out << "    \"" << Escape(tree.name(cat), escapeQuoted) << "\" " << 
+        "f.title" << std::endl;
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
     {
-        if (categoryNotExcluded(subCats[x]))
-            std::cout << "    \"" << subCats[x]->name << "\" " << "f.menu " <<
-                    '"' << subCats[x]->name << '"' << std::endl;
+        if (tree.visible(sub))
+            out << "    \"" << Escape(tree.name(sub), escapeQuoted) << "\" " << 
+                    "f.menu " << '"' << Escape(tree.name(sub), escapeQuoted) << 
+                    '"' << std::endl;
     }
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {
-        if ((*it)->nodisplay) continue;
-        std::cout << "    \"" << (*it)->name << "\" " << "f.exec " << 
-            "\"exec " << (*it)->exec << " &\"" << std::endl;
+        out << "    \"" << Escape(entries.name(*it), escapeQuoted) << "\" " << 
+            "f.exec " << "\"exec " << 
+            Escape(entries.execPrefix(*it), escapeQuoted) << 
+            Escape(entries.exec(*it), escapeQuoted) << " &\"" << std::endl;
     }
-    std::cout << "}" << std::endl << std::endl;
+    out << "}" << std::endl << std::endl;
 }
 
 void MwmMenuWriter::writeMainMenu()
 {
-    std::cout << "menu \"" << menuName << '"' << std::endl << "{" << std::endl;
-    std::cout << "    \"" << menuName << "\" " << "f.title" << std::endl;
+    out << "menu \"" << Escape(config.menuName, escapeQuoted) << '"' << 
+        std::endl << "{" << std::endl;
+    out << "    \"" << Escape(config.menuName, escapeQuoted) << "\" " << 
+        "f.title" << std::endl;
     for (unsigned int x = 0; x < usedCats.size(); x++)
     {  
-        std::cout << "    \"" << usedCats[x]->name << "\" " << "f.menu " <<
-            '"' << usedCats[x]->name << '"' << std::endl;
+        out << "    \"" << Escape(tree.name(usedCats[x]), escapeQuoted) << 
+            "\" " << "f.menu " << '"' << 
+            Escape(tree.name(usedCats[x]), escapeQuoted) << '"' << std::endl;
     }
-    std::cout << "}" << std::endl << std::endl;
+    out << "}" << std::endl << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -213,81 +216,92 @@ void MwmMenuWriter::writeMainMenu()
 
 FvwmMenuWriter::FvwmMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
+}
+
+void FvwmMenuWriter::write()
+{
+    writeMenus();
     if (!usedCats.empty()) writeMainMenu();
 }
 
-void FvwmMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void FvwmMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
     if (windowmanager == fvwm)
-        std::cout << "DestroyMenu \"" << cat->name << '"' << std::endl;
+        out << "DestroyMenu \"" << Escape(tree.name(cat), escapeQuoted) << '"' << 
+            std::endl;
     else
-        std::cout << "DestroyMenu recreate \"" << cat->name << '"' << std::endl;
-    std::cout << "AddToMenu \"" << cat->name << "\" " << 
-        '"' << cat->name << "\" Title" << std::endl;
-    for (unsigned int x = 0; x < subCats.size(); x++)
+        out << "DestroyMenu recreate \"" << 
+            Escape(tree.name(cat), escapeQuoted) << '"' << std::endl;
+    out << "AddToMenu \"" << Escape(tree.name(cat), escapeQuoted) << "\" " << 
+        '"' << Escape(tree.name(cat), escapeFvwmLabel) << "\" Title" << std::endl;
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
     {   
-        if (categoryNotExcluded(subCats[x]))
+        if (tree.visible(sub))
         {
-            if (useIcons && subCats[x]->icon != "")
+            if (useIcons && tree.icon(sub) != "")
             {
-                std::cout << "+ \"" << subCats[x]->name << " %" << 
-                    subCats[x]->icon << "%\" Popup " << 
-                    '"' + subCats[x]->name + '"' << std::endl;
+                out << "+ \"" << Escape(tree.name(sub), escapeFvwmLabel) << 
+                    " %" << tree.icon(sub) << "%\" Popup " << 
+                    '"' << Escape(tree.name(sub), escapeQuoted) << '"' << std::endl;
             }
             else
             {
-                std::cout << "+ \"" << subCats[x]->name << "\" " << "Popup " << 
-                    '"' + subCats[x]->name + '"' << std::endl;
+                out << "+ \"" << Escape(tree.name(sub), escapeFvwmLabel) << 
+                    "\" " << "Popup " << '"' << 
+                    Escape(tree.name(sub), escapeQuoted) << '"' << std::endl;
             }
         }
     }
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
-        if (useIcons && (*it)->icon != "")
+        if (useIcons && entries.hasIcon(*it))
         {
-            std::cout << "+ \"" << (*it)->name << " %" << 
-                (*it)->icon << "%\" Exec exec " << 
-                (*it)->exec << std::endl;
+            out << "+ \"" << Escape(entries.name(*it), escapeFvwmLabel) << 
+                " %" << entries.icon(*it) << "%\" Exec exec " << 
+                entries.execPrefix(*it) << entries.exec(*it) << std::endl;
         }
         else
         {
-            std::cout << "+ \"" << (*it)->name << "\" " << "Exec exec " << 
-                (*it)->exec << std::endl;
+            out << "+ \"" << Escape(entries.name(*it), escapeFvwmLabel) << 
+                "\" " << "Exec exec " << entries.execPrefix(*it) << 
+                entries.exec(*it) << std::endl;
         }
     }
-    std::cout << std::endl;
+    out << std::endl;
 }
 
 void FvwmMenuWriter::writeMainMenu()
 {
     if (windowmanager == fvwm)
-        std::cout << "DestroyMenu \"" << menuName << '"' << std::endl;
+        out << "DestroyMenu \"" << Escape(config.menuName, escapeQuoted) << '"' << 
+            std::endl;
     else
-        std::cout << "DestroyMenu recreate \"" << menuName << '"' << std::endl;
-    std::cout << "AddToMenu \"" << menuName << "\" " << 
-        '"' << menuName << "\" Title" << std::endl;
+        out << "DestroyMenu recreate \"" << 
+            Escape(config.menuName, escapeQuoted) << '"' << std::endl;
+    out << "AddToMenu \"" << Escape(config.menuName, escapeQuoted) << "\" " << 
+        '"' << Escape(config.menuName, escapeFvwmLabel) << "\" Title" << std::endl;
     for (unsigned int x = 0; x < usedCats.size(); x++)
     {   
-        if (useIcons && usedCats[x]->icon != "")
+        if (useIcons && tree.icon(usedCats[x]) != "")
         {
-            std::cout << "+ \"" << usedCats[x]->name << " %" << 
-                usedCats[x]->icon << "%\" Popup " << 
-                '"' + usedCats[x]->name + '"' << std::endl;
+            out << "+ \"" << Escape(tree.name(usedCats[x]), escapeFvwmLabel) << 
+                " %" << tree.icon(usedCats[x]) << "%\" Popup " << '"' << 
+                Escape(tree.name(usedCats[x]), escapeQuoted) << '"' << std::endl;
         }
         else
         {
-            std::cout << "+ \"" << usedCats[x]->name << "\" " << "Popup " << 
-                '"' + usedCats[x]->name + '"' << std::endl;
+            out << "+ \"" << Escape(tree.name(usedCats[x]), escapeFvwmLabel) << 
+                "\" " << "Popup " << '"' << 
+                Escape(tree.name(usedCats[x]), escapeQuoted) << '"' << std::endl;
         }
     }
-    std::cout << std::endl;
+    out << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -296,173 +310,240 @@ void FvwmMenuWriter::writeMainMenu()
 
 FluxboxMenuWriter::FluxboxMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
 }
 
-void FluxboxMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void FluxboxMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
     if (catNumber == 0) 
-        std::cout << "[submenu] (" << menuName << ')' << std::endl;
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    if (useIcons && cat->icon != "")
+        out << "[submenu] (" << Escape(config.menuName, escapeFluxboxLabel) << 
+            ')' << std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    if (useIcons && tree.icon(cat) != "")
     {
-        std::cout << "    [submenu] (" << cat->name << ") <" << cat->icon 
-            << "> {}" << std::endl;
+        out << "    [submenu] (" << Escape(tree.name(cat), escapeFluxboxLabel) << 
+            ") <" << tree.icon(cat) << "> {}" << std::endl;
     }
     else
     {
-        std::cout << "    [submenu] (" << cat->name << ") {}" << std::endl;
+        out << "    [submenu] (" << Escape(tree.name(cat), escapeFluxboxLabel) << 
+            ") {}" << std::endl;
     }
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::string theName = (*it)->name;
-        //If a name has brackets, we need to escape the closing
-        //bracket or it will be missed out
-        boost::replace_all(theName, ")", "\\)");
-        std::cout << "        [exec] (" << theName << ") " << 
-            "{" << (*it)->exec << "}";
-        if (useIcons && (*it)->icon != "")
-            std::cout << " <" << (*it)->icon << ">" << std::endl;
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        out << "        [exec] (" << 
+            Escape(entries.name(*it), escapeFluxboxLabel) << ") " << "{" << 
+            Escape(entries.execPrefix(*it), escapeFluxboxCommand) << 
+            Escape(entries.exec(*it), escapeFluxboxCommand) << "}";
+        if (useIcons && entries.hasIcon(*it))
+            out << " <" << entries.icon(*it) << ">" << std::endl;
         else
-            std::cout << std::endl;
+            out << std::endl;
     }
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    std::cout << "    [end]" << std::endl;
-    if (catNumber >= 0 && catNumber == maxCatNumber) std::cout << "[end]" << std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    out << "    [end]" << std::endl;
+    if (catNumber >= 0 && catNumber == maxCatNumber) out << "[end]" << std::endl;
 }
 
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 
-OpenboxMenuWriter::OpenboxMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
+/* For Openbox pipe menus, there are two further modes. If pipeCommand is 
+ * given, each category is written as a pipe menu which runs pipeCommand with 
+ * --category to get its contents. If pipeContents is true, the contents of 
+ * the single category given are written as the pipe menu */
+OpenboxMenuWriter::OpenboxMenuWriter(WRITER_CONSTRUCT, const std::string& pipeCommand,
+        bool pipeContents) : MenuWriter(WRITER_PARAMS),
+    pipeCommand(pipeCommand),
+    pipeContents(pipeContents)
+{
+}
+
+void OpenboxMenuWriter::write()
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
+    if (windowmanager == openbox_pipe && (pipeCommand != "" || pipeContents))
+    {
+        out << "<openbox_pipe_menu xmlns=\"http://openbox.org/3.4/menu\">"
+            << std::endl << std::endl;
+        if (pipeContents && !usedCats.empty()) writePipeContents(usedCats[0]);
+        if (!pipeContents) writePipeStubs();
+        out << "</openbox_pipe_menu>" << std::endl << std::endl;
+        return;
+    }
+    writeMenus();
     if (!usedCats.empty() && windowmanager == openbox) writeMainMenu();
 }
 
-void OpenboxMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void OpenboxMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
     if (windowmanager == openbox_pipe && catNumber == 0) 
-        std::cout << 
+        out << 
             "<openbox_pipe_menu xmlns=\"http://openbox.org/3.4/menu\">"
             << std::endl << std::endl;
     if (windowmanager == openbox)
     {
-        for (unsigned int x = 0; x < subCats.size(); x++)
-            if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
+        for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+            if (tree.visible(sub)) writeMenu(out, sub);
     }  
     if (useIcons)
     {
-        if (cat->icon != "")
+        if (tree.icon(cat) != "")
         {
             if (windowmanager == openbox_pipe)
-               for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-            std::cout << "<menu id=\"" << cat->name << "\" label=\"" << 
-                cat->name << "\" icon=" << '"' + cat->icon + '"' << 
-                ">" << std::endl;
+               for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+            out << "<menu id=\"" << Escape(tree.name(cat), escapeXml) << 
+                "\" label=\"" << Escape(tree.name(cat), escapeXml) << "\" icon=\"" << 
+                Escape(tree.icon(cat), escapeXml) << "\">" << std::endl;
         }
         else
         {
             if (windowmanager == openbox_pipe)
-                for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-            std::cout << "<menu id=\"" << cat->name << "\" label=\"" << 
-                cat->name << "\">" << std::endl;
+                for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+            out << "<menu id=\"" << Escape(tree.name(cat), escapeXml) << 
+                "\" label=\"" << Escape(tree.name(cat), escapeXml) << "\">" << 
+                std::endl;
         }
     }
     else 
     {
         if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "<menu id=\"" << cat->name << "\" label=\"" << 
-            cat->name << "\">" << std::endl;
+            for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        out << "<menu id=\"" << Escape(tree.name(cat), escapeXml) << "\" label=\"" << 
+            Escape(tree.name(cat), escapeXml) << "\">" << std::endl;
     }
     if (windowmanager == openbox)
     {
-        for (unsigned int x = 0; x < subCats.size(); x++)
+        for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
         {   
-            if (categoryNotExcluded(subCats[x]))
+            if (tree.visible(sub))
             {
-                if (useIcons && subCats[x]->icon != "")
+                if (useIcons && tree.icon(sub) != "")
                 {
-                    std::cout << "    <menu id=\"" << subCats[x]->name << "\" icon=\""
-                       << subCats[x]->icon << "\"/>" << std::endl;
+                    out << "    <menu id=\"" << Escape(tree.name(sub), escapeXml) << 
+                        "\" icon=\"" << Escape(tree.icon(sub), escapeXml) << "\"/>" << 
+                        std::endl;
                 }
                 else
                 {
-                    std::cout << "    <menu id=\"" << subCats[x]->name << "\"/>" << std::endl;
+                    out << "    <menu id=\"" << 
+                        Escape(tree.name(sub), escapeXml) << "\"/>" << 
+                        std::endl;
                 }
             }
         }
     }
     if (windowmanager == openbox_pipe)
     {
-        for (unsigned int x = 0; x < subCats.size(); x++)
-            if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
+        for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+            if (tree.visible(sub)) writeMenu(out, sub);
     } 
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
-        if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        if (useIcons && (*it)->icon != "")
-        {
-            std::cout << "    <item label=\"" << (*it)->name << "\" icon=\""
-               << (*it)->icon << "\">" << std::endl;
-        }
-        else
-        {
-            std::cout << "    <item label=\"" << (*it)->name << "\">" << std::endl;
-        }
-        if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "        <action name=\"Execute\">" << std::endl;
-        if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "            <execute>" << (*it)->exec << 
-            "</execute>" << std::endl;
-        if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "        </action>" << std::endl;
-        if (windowmanager == openbox_pipe)
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "    </item>" << std::endl;
+        writeEntry(out, *it, windowmanager == openbox_pipe ? tree.depth(cat) : 0);
     }
     if (windowmanager == openbox_pipe) 
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    if (windowmanager == openbox_pipe && cat->depth != 0)
-        std::cout << "</menu>" << std::endl;
-    else std::cout << "</menu>" << std::endl << std::endl;
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    if (windowmanager == openbox_pipe && tree.depth(cat) != 0)
+        out << "</menu>" << std::endl;
+    else out << "</menu>" << std::endl << std::endl;
     if (windowmanager == openbox_pipe && catNumber >= 0 && catNumber == maxCatNumber)
-        std::cout << "</openbox_pipe_menu>" << std::endl << std::endl;
+        out << "</openbox_pipe_menu>" << std::endl << std::endl;
+}
+
+/* Write a single entry as an item, indented for the given depth */
+void OpenboxMenuWriter::writeEntry(std::ostream& out, unsigned int entry, 
+        int depth)
+{
+    for (int x = 0; x < depth; x++) out << "    ";
+    if (useIcons && entries.hasIcon(entry))
+    {
+        out << "    <item label=\"" << Escape(entries.name(entry), escapeXml) << 
+            "\" icon=\"" << Escape(entries.icon(entry), escapeXml) << "\">" << 
+            std::endl;
+    }
+    else
+    {
+        out << "    <item label=\"" << Escape(entries.name(entry), escapeXml) << 
+            "\">" << 
+            std::endl;
+    }
+    for (int x = 0; x < depth; x++) out << "    ";
+    out << "        <action name=\"Execute\">" << std::endl;
+    for (int x = 0; x < depth; x++) out << "    ";
+    out << "            <execute>" << Escape(entries.execPrefix(entry), escapeXml) << 
+        Escape(entries.exec(entry), escapeXml) << "</execute>" << std::endl;
+    for (int x = 0; x < depth; x++) out << "    ";
+    out << "        </action>" << std::endl;
+    for (int x = 0; x < depth; x++) out << "    ";
+    out << "    </item>" << std::endl;
+}
+
+/* Write each category as a pipe menu whose contents come from running 
+ * pipeCommand for that category. The command is already quoted for the 
+ * shell, but the category name needs quoting */
+void OpenboxMenuWriter::writePipeStubs()
+{
+    for (unsigned int x = 0; x < usedCats.size(); x++)
+    {
+        std::string command = pipeCommand + " --category '";
+        std::string name = tree.name(usedCats[x]);
+        boost::replace_all(name, "'", "'\\''");
+        command += name + "'";
+        out << "<menu id=\"" << Escape(tree.name(usedCats[x]), escapeXml) << 
+            "\" label=\"" << Escape(tree.name(usedCats[x]), escapeXml) << '"';
+        if (useIcons && tree.icon(usedCats[x]) != "")
+            out << " icon=\"" << Escape(tree.icon(usedCats[x]), escapeXml) << '"';
+        out << " execute=\"" << Escape(command, escapeXml) << "\"/>" << std::endl;
+    }
+    out << std::endl;
+}
+
+/* Write the subcategories and entries of a single category, which is the 
+ * content of its pipe menu */
+void OpenboxMenuWriter::writePipeContents(unsigned int cat)
+{
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
+    {   
+        writeEntry(out, *it, 0);
+    }
+    out << std::endl;
 }
 
 void OpenboxMenuWriter::writeMainMenu()
 {
-    std::cout << "<menu id=\"" << menuName << "\" label=\"" << menuName << "\">" << std::endl;
+    out << "<menu id=\"" << Escape(config.menuName, escapeXml) << "\" label=\"" << 
+        Escape(config.menuName, escapeXml) << "\">" << std::endl;
     for (unsigned int x = 0; x < usedCats.size(); x++)
     {   
-        if (useIcons && usedCats[x]->icon != "")
+        if (useIcons && tree.icon(usedCats[x]) != "")
         {
-            std::cout << "    <menu id=\"" << usedCats[x]->name << "\" icon=\""
-               << usedCats[x]->icon << "\"/>" << std::endl;
+            out << "    <menu id=\"" << Escape(tree.name(usedCats[x]), escapeXml) << 
+                "\" icon=\"" << Escape(tree.icon(usedCats[x]), escapeXml) << "\"/>" << 
+                std::endl;
         }
         else
         {
-            std::cout << "    <menu id=\"" << usedCats[x]->name << "\"/>" << std::endl;
+            out << "    <menu id=\"" << 
+                Escape(tree.name(usedCats[x]), escapeXml) << "\"/>" << 
+                std::endl;
         }
     }
-    std::cout << "</menu>" << std::endl << std::endl;
+    out << "</menu>" << std::endl << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -471,33 +552,36 @@ void OpenboxMenuWriter::writeMainMenu()
 
 OlvwmMenuWriter::OlvwmMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
 }
 
-void OlvwmMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void OlvwmMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
     if (catNumber == 0) 
-        std::cout << '"' << menuName << "\" MENU" << std::endl << std::endl;
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    std::cout << '"' << cat->name << "\" MENU" << std::endl;
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+        out << '"' << Escape(config.menuName, escapeQuoted) << "\" MENU" << 
+            std::endl << std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    out << '"' << Escape(tree.name(cat), escapeQuoted) << "\" MENU" << std::endl;
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << '"' << (*it)->name << "\" " << (*it)->exec << std::endl;
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        out << '"' << Escape(entries.name(*it), escapeQuoted) << "\" " << 
+            entries.execPrefix(*it) << entries.exec(*it) << std::endl;
     }
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    if (cat->depth == 0)
-        std::cout << '"' << cat->name << "\" END PIN" << std::endl << std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    if (tree.depth(cat) == 0)
+        out << '"' << Escape(tree.name(cat), escapeQuoted) << "\" END PIN" << 
+            std::endl << 
+            std::endl;
     else
-        std::cout << '"' << cat->name << "\" END PIN" << std::endl;
+        out << '"' << Escape(tree.name(cat), escapeQuoted) << "\" END PIN" << std::endl;
     if (catNumber >= 0 && catNumber == maxCatNumber) 
-        std::cout << '"' << menuName << "\" END PIN" << std::endl;
+        out << '"' << Escape(config.menuName, escapeQuoted) << "\" END PIN" << 
+            std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -506,53 +590,55 @@ void OlvwmMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
 
 WmakerMenuWriter::WmakerMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
 }
 
-void WmakerMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void WmakerMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
     int numOfItems = 0;
     int realPos = 0;
-    if (catNumber == 0 && cat->depth == 0) 
-        std::cout << "(\n    \"" << menuName << "\"," << std::endl;
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    std::cout << "    (" << std::endl;
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    std::cout << "        \"" << cat->name << "\"," << std::endl;
+    if (catNumber == 0 && tree.depth(cat) == 0) 
+        out << "(\n    \"" << Escape(config.menuName, escapeQuoted) << "\"," << 
+            std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    out << "    (" << std::endl;
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    out << "        \"" << Escape(tree.name(cat), escapeQuoted) << "\"," << std::endl;
     //For Windowmaker we have to exactly how many items there are
     //in menu (submenus + desktop entries) because we have to
     //terminate each entry other than the final one with a comma
-    if (subCats.size() > 0) numOfItems = realNumEntries(dfiles) + realNumCats(subCats) - 1;
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x], x, numOfItems);
+    if (tree.firstChild(cat) != NO_CATEGORY_NODE) 
+        numOfItems = tree.numMembers(cat) + tree.numChildren(cat) - 1;
+    int x = 0;
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub), x++)
+        if (tree.visible(sub)) writeMenu(out, sub, x, numOfItems);
     realPos = 0;
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
         realPos++;
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "        (\"" << (*it)->name << "\", " << "EXEC, \"" << 
-            (*it)->exec << "\")";
-        if (realPos < realNumEntries(dfiles))
-            std::cout << ',' << std::endl;
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        out << "        (\"" << Escape(entries.name(*it), escapeQuoted) << "\", " << 
+            "EXEC, \"" << Escape(entries.execPrefix(*it), escapeQuoted) << 
+            Escape(entries.exec(*it), escapeQuoted) << "\")";
+        if (realPos < (int)tree.numMembers(cat))
+            out << ',' << std::endl;
         else 
-            std::cout << std::endl;
+            out << std::endl;
     }
     if (catNumber >= 0 && catNumber != maxCatNumber) 
     {
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        std::cout << "    )," << std::endl;
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        out << "    )," << std::endl;
     }
     else 
     {
-        if (cat->depth == 0) std::cout << "    )\n)" << std::endl;
+        if (tree.depth(cat) == 0) out << "    )\n)" << std::endl;
         else
         {
-            for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-            std::cout << "    )" << std::endl;
+            for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+            out << "    )" << std::endl;
         }
     }
 }
@@ -563,46 +649,49 @@ void WmakerMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
 
 IcewmMenuWriter::IcewmMenuWriter(WRITER_CONSTRUCT) : MenuWriter(WRITER_PARAMS)
 {
-    for (unsigned int x = 0; x < usedCats.size(); x++) 
-        writeMenu(usedCats[x], x, usedCats.size() - 1);
 }
 
-void IcewmMenuWriter::writeMenu(Category *cat, int catNumber, int maxCatNumber)
+void IcewmMenuWriter::writeMenu(std::ostream& out, unsigned int cat, int catNumber, 
+        int maxCatNumber)
 {
-    std::vector<DesktopFile*> dfiles = cat->getEntries();
-    std::vector<Category*> subCats = cat->getSubcats();
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
     if (useIcons)
     {
-        if (cat->icon != "")
-            std::cout << "menu \"" << cat->name << "\" " << cat->icon << " {" << std::endl;
+        if (tree.icon(cat) != "")
+            out << "menu \"" << Escape(tree.name(cat), escapeQuoted) << "\" " << 
+                tree.icon(cat) << " {" << std::endl;
         else
-            std::cout << "menu \"" << cat->name << "\" - {" << std::endl;
+            out << "menu \"" << Escape(tree.name(cat), escapeQuoted) << "\" - {" << 
+                std::endl;
     }
     else
     {
-        std::cout << "menu \"" << cat->name << "\" folder {" << std::endl;
+        out << "menu \"" << Escape(tree.name(cat), escapeQuoted) << "\" folder {" << 
+            std::endl;
     }
-    for (unsigned int x = 0; x < subCats.size(); x++)
-        if (categoryNotExcluded(subCats[x])) writeMenu(subCats[x]);
-    for (std::vector<DesktopFile*>::iterator it = dfiles.begin(); it < dfiles.end(); it++)
+    for (unsigned int sub = tree.firstChild(cat); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) writeMenu(out, sub);
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(cat); 
+            it < tree.membersEnd(cat); it++)
     {   
-        if ((*it)->nodisplay) continue;
-        for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-        if (useIcons && (*it)->icon != "")
+        for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+        if (useIcons && entries.hasIcon(*it))
         {
-            std::cout << "    prog \"" << (*it)->name << "\" " << 
-                (*it)->icon << " " << (*it)->exec << std::endl;
+            out << "    prog \"" << Escape(entries.name(*it), escapeQuoted) << "\" " << 
+                entries.icon(*it) << " " << entries.execPrefix(*it) << 
+                entries.exec(*it) << std::endl;
         }
         else
         {
-            std::cout << "    prog \"" + (*it)->name + "\" - " << 
-                (*it)->exec << std::endl;
+            out << "    prog \"" << Escape(entries.name(*it), escapeQuoted) << 
+                "\" - " << 
+                entries.execPrefix(*it) << entries.exec(*it) << std::endl;
         }
     }
-    for (int x = 0; x < cat->depth; x++) std::cout << "    ";
-    if (cat->depth == 0) std::cout << "}\n" << std::endl;
-    else std::cout << "}\n";
+    for (int x = 0; x < tree.depth(cat); x++) out << "    ";
+    if (tree.depth(cat) == 0) out << "}\n" << std::endl;
+    else out << "}\n";
 }
 
 //------------------------------------------------------------------------------
@@ -21,57 +21,51 @@
 #ifndef _MENU_WRITER_H_
 #define _MENU_WRITER_H_
 
+#include <ostream>
 #include "DesktopFile.h"
-
-//WM id numbers
-enum WindowManager
-{
-    mwm = 0,
-    fvwm,
-    fvwm_dynamic,
-    fluxbox,
-    openbox,
-    openbox_pipe,
-    olvwm,
-    windowmaker,
-    icewm
-};
+#include "EntryTable.h"
+#include "RunConfig.h"
+#include "CategoryTree.h"
 
 #define DEFAULT_CAT_NUM -1
 #define DEFAULT_MAX_CAT_NUM -1
 
-#define WRITER_CONSTRUCT const std::string& menuName, WindowManager windowmanager,\
-        bool useIcons, std::vector<std::string> exclude, std::vector<std::string> excludeMatching,\
-        std::vector<std::string> excludeCategories, std::vector<std::string> include,\
-        std::vector<std::string> excludedFilenames, const std::vector<Category*>& cats
+#define WRITER_CONSTRUCT std::ostream& out, const RunConfig& config,\
+        WindowManager windowmanager, bool useIcons,\
+        const CategoryTree& tree, const EntryTable& entries
 
-#define WRITER_PARAMS menuName, windowmanager, useIcons, exclude, excludeMatching,\
-        excludeCategories, include, excludedFilenames, cats
+#define WRITER_PARAMS out, config, windowmanager, useIcons, tree, entries
 
 class MenuWriter
 {   
     public:
         MenuWriter(WRITER_CONSTRUCT);
 
+        virtual void write();
+
+        static void filterCategories(
+                const std::vector<Category*>& cats,
+                EntryTable& entries, const RunConfig& config);
+
     protected:
-        std::vector<Category*> cats;
-        std::string menuName;
+        std::ostream& out;
+        const RunConfig& config;
         WindowManager windowmanager;
         bool useIcons;
-        std::vector<std::string> exclude;
-        std::vector<std::string> excludeMatching;
-        std::vector<std::string> excludeCategories;
-        std::vector<std::string> include;
-        std::vector<std::string> excludedFilenames;
-
-        std::vector<Category*> usedCats;
+        const CategoryTree& tree;
+        const EntryTable& entries;
+        //The visible top level categories
+        std::vector<unsigned int> usedCats;
+
+        void writeMenus();
+        //Write a category and its subcategories. Categories are written to
+        //the stream given rather than to out, so that they can be written 
+        //into separate buffers
+        virtual void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber, int maxCatNumber) = 0;
 
-        void entryDisplayHandler();
-        bool categoryNotExcluded(Category* c);
-        int realNumEntries(std::vector<DesktopFile*> entries);
-        int realNumCats(std::vector<Category*> cats);
-
-        virtual void writeMenu(Category* cat, int catNumber, int maxCatNumber) = 0;
+    private:
+        static void *writeMenusThread(void *queue);
 };
 
 class MwmMenuWriter : MenuWriter
@@ -79,8 +73,11 @@ class MwmMenuWriter : MenuWriter
     public:
         MwmMenuWriter(WRITER_CONSTRUCT);
 
+        void write();
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
         void writeMainMenu();
 };
 
@@ -89,8 +86,11 @@ class FvwmMenuWriter : MenuWriter
     public:
         FvwmMenuWriter(WRITER_CONSTRUCT);
 
+        void write();
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
         void writeMainMenu();
 };
 
@@ -99,18 +99,31 @@ class FluxboxMenuWriter : MenuWriter
     public:
         FluxboxMenuWriter(WRITER_CONSTRUCT);
 
+        using MenuWriter::write;
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
 };
 
 class OpenboxMenuWriter : MenuWriter
 {
     public:
-        OpenboxMenuWriter(WRITER_CONSTRUCT);
+        OpenboxMenuWriter(WRITER_CONSTRUCT, const std::string& pipeCommand = "",
+                bool pipeContents = false);
+
+        void write();
 
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        std::string pipeCommand;
+        bool pipeContents;
+
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
         void writeMainMenu();
+        void writeEntry(std::ostream& out, unsigned int entry, int depth);
+        void writePipeStubs();
+        void writePipeContents(unsigned int cat);
 };
 
 class OlvwmMenuWriter : MenuWriter
@@ -118,8 +131,11 @@ class OlvwmMenuWriter : MenuWriter
     public:
         OlvwmMenuWriter(WRITER_CONSTRUCT);
 
+        using MenuWriter::write;
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
 };
 
 class WmakerMenuWriter : MenuWriter
@@ -127,8 +143,11 @@ class WmakerMenuWriter : MenuWriter
     public:
         WmakerMenuWriter(WRITER_CONSTRUCT);
 
+        using MenuWriter::write;
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
 };
 
 class IcewmMenuWriter : MenuWriter
@@ -136,8 +155,11 @@ class IcewmMenuWriter : MenuWriter
     public:
         IcewmMenuWriter(WRITER_CONSTRUCT);
 
+        using MenuWriter::write;
+
     private:
-        void writeMenu(Category* cat, int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
+        void writeMenu(std::ostream& out, unsigned int cat, 
+                int catNumber = DEFAULT_CAT_NUM, int = DEFAULT_MAX_CAT_NUM);
 };
 
 #endif
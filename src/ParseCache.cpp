@@ -0,0 +1,429 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "boost/filesystem.hpp"
+#include "ParseCache.h"
+#include "DesktopFile.h"
+
+//Helpers for the cache file format. Numbers are stored in host byte order,
+//strings as a length followed by the bytes
+static void putU32(std::string& buf, uint32_t value)
+{
+    buf.append((const char*)&value, sizeof(value));
+}
+
+static void putI64(std::string& buf, int64_t value)
+{
+    buf.append((const char*)&value, sizeof(value));
+}
+
+static void putString(std::string& buf, const std::string& value)
+{
+    putU32(buf, value.size());
+    buf.append(value);
+}
+
+static void putStrings(std::string& buf, const std::vector<std::string>& values)
+{
+    putU32(buf, values.size());
+    for (unsigned int x = 0; x < values.size(); x++) putString(buf, values[x]);
+}
+
+struct CacheReader
+{   const std::string& buf;
+    size_t pos;
+    bool ok;
+
+    CacheReader(const std::string& buf) : buf(buf), pos(0), ok(true) {}
+
+    bool get(void *value, size_t size)
+    {
+        if (!ok || buf.size() - pos < size) return ok = false;
+        memcpy(value, buf.data() + pos, size);
+        pos += size;
+        return true;
+    }
+    uint32_t getU32()
+    {
+        uint32_t value = 0;
+        get(&value, sizeof(value));
+        return value;
+    }
+    int64_t getI64()
+    {
+        int64_t value = 0;
+        get(&value, sizeof(value));
+        return value;
+    }
+    std::string getString()
+    {
+        uint32_t size = getU32();
+        if (!ok || buf.size() - pos < size)
+        {
+            ok = false;
+            return "";
+        }
+        pos += size;
+        return buf.substr(pos - size, size);
+    }
+    void getStrings(std::vector<std::string>& values)
+    {
+        uint32_t count = getU32();
+        for (uint32_t x = 0; x < count && ok; x++) 
+            values.push_back(getString());
+    }
+};
+
+ParseCache::ParseCache(const std::string& cacheFile, bool enabled) :
+    cacheFile(cacheFile),
+    enabled(enabled),
+    dirty(false)
+{
+    if (enabled) load();
+}
+
+/* Return the location of the cache file, which lives in $XDG_CACHE_HOME or
+ * ~/.cache if that isn't set */
+std::string ParseCache::defaultPath(const std::string& homedir)
+{
+    const char *cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome != NULL && cacheHome[0] == '/') 
+        return std::string(cacheHome) + "/mwmmenu/parse.cache";
+    return homedir + "/.cache/mwmmenu/parse.cache";
+}
+
+/* Read the cache file. If it is missing, from another version or damaged, 
+ * we simply start with an empty cache */
+void ParseCache::load()
+{
+    std::ifstream cache_f(cacheFile.c_str(), std::ios::in | std::ios::binary);
+    if (!cache_f) return;
+    std::ostringstream contents;
+    contents << cache_f.rdbuf();
+    cache_f.close();
+    std::string buf = contents.str();
+
+    CacheReader reader(buf);
+    char magic[8];
+    reader.get(magic, sizeof(magic));
+    if (!reader.ok || memcmp(magic, PARSE_CACHE_MAGIC, sizeof(magic)) != 0 ||
+            reader.getU32() != PARSE_CACHE_VERSION)
+        return;
+    uint32_t entryCount = reader.getU32();
+    uint32_t dirCount = reader.getU32();
+    uint32_t nameListCount = reader.getU32();
+    for (uint32_t x = 0; x < entryCount && reader.ok; x++)
+    {
+        std::string path = reader.getString();
+        CachedEntry& entry = entries[path];
+        entry.used = false;
+        entry.mtime = reader.getI64();
+        entry.mtimeNsec = reader.getI64();
+        entry.size = reader.getI64();
+        entry.name = reader.getString();
+        entry.exec = reader.getString();
+        entry.icon = reader.getString();
+        entry.tryExec = reader.getString();
+        uint32_t flags = reader.getU32();
+        entry.nodisplay = flags & 0x1;
+        entry.terminal = flags & 0x2;
+        entry.hidden = flags & 0x4;
+        reader.getStrings(entry.categories);
+        reader.getStrings(entry.onlyShowIn);
+    }
+    for (uint32_t x = 0; x < dirCount + nameListCount && reader.ok; x++)
+    {
+        std::string path = reader.getString();
+        CachedDir& listing = (x < dirCount) ? dirs[path] : nameLists[path];
+        listing.used = false;
+        listing.mtime = reader.getI64();
+        listing.mtimeNsec = reader.getI64();
+        uint32_t count = reader.getU32();
+        for (uint32_t y = 0; y < count && reader.ok; y++)
+        {
+            listing.names.push_back(reader.getString());
+            listing.isDir.push_back(reader.getU32() != 0);
+        }
+    }
+    if (!reader.ok)
+    {
+        entries.clear();
+        dirs.clear();
+        nameLists.clear();
+    }
+}
+
+/* Write the cache file if anything was added to it. Entries and listings 
+ * that weren't used in this run are kept, since a run with other options may
+ * need them, unless their file or directory has gone away */
+void ParseCache::save()
+{
+    if (!enabled || !dirty) return;
+    struct stat st;
+    std::map<std::string, CachedEntry>::iterator e = entries.begin();
+    std::map<std::string, CachedDir>::iterator d = dirs.begin();
+    while (e != entries.end())
+    {
+        if (!e->second.used && stat(e->first.c_str(), &st) != 0) 
+            entries.erase(e++);
+        else e++;
+    }
+    while (d != dirs.end())
+    {
+        if (!d->second.used && stat(d->first.c_str(), &st) != 0) 
+            dirs.erase(d++);
+        else d++;
+    }
+    d = nameLists.begin();
+    while (d != nameLists.end())
+    {
+        if (!d->second.used && stat(d->first.c_str(), &st) != 0) 
+            nameLists.erase(d++);
+        else d++;
+    }
+    uint32_t entryCount = entries.size();
+    uint32_t dirCount = dirs.size();
+    uint32_t nameListCount = nameLists.size();
+
+    std::string buf;
+    buf.append(PARSE_CACHE_MAGIC, 8);
+    putU32(buf, PARSE_CACHE_VERSION);
+    putU32(buf, entryCount);
+    putU32(buf, dirCount);
+    putU32(buf, nameListCount);
+    for (e = entries.begin(); e != entries.end(); e++)
+    {
+        const CachedEntry& entry = e->second;
+        putString(buf, e->first);
+        putI64(buf, entry.mtime);
+        putI64(buf, entry.mtimeNsec);
+        putI64(buf, entry.size);
+        putString(buf, entry.name);
+        putString(buf, entry.exec);
+        putString(buf, entry.icon);
+        putString(buf, entry.tryExec);
+        putU32(buf, (entry.nodisplay ? 0x1 : 0) | (entry.terminal ? 0x2 : 0) |
+                (entry.hidden ? 0x4 : 0));
+        putStrings(buf, entry.categories);
+        putStrings(buf, entry.onlyShowIn);
+    }
+    for (unsigned int x = 0; x < 2; x++)
+    {
+        std::map<std::string, CachedDir>& listings = (x == 0) ? dirs : nameLists;
+        for (d = listings.begin(); d != listings.end(); d++)
+        {
+            const CachedDir& listing = d->second;
+            putString(buf, d->first);
+            putI64(buf, listing.mtime);
+            putI64(buf, listing.mtimeNsec);
+            putU32(buf, listing.names.size());
+            for (unsigned int y = 0; y < listing.names.size(); y++)
+            {
+                putString(buf, listing.names[y]);
+                putU32(buf, listing.isDir[y] ? 1 : 0);
+            }
+        }
+    }
+
+    try
+    {
+        boost::filesystem::create_directories(
+                boost::filesystem::path(cacheFile).parent_path());
+    }
+    catch (boost::filesystem::filesystem_error&)
+    {
+        return;
+    }
+    //Each process writes its own temporary file, so concurrent saves can't 
+    //interleave and the last rename wins with a complete cache
+    std::ostringstream tmpName;
+    tmpName << cacheFile << "." << getpid() << ".tmp";
+    std::string tmpPath = tmpName.str();
+    std::ofstream cache_f(tmpPath.c_str(), 
+            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!cache_f) return;
+    cache_f.write(buf.data(), buf.size());
+    cache_f.close();
+    if (!cache_f || rename(tmpPath.c_str(), cacheFile.c_str()) != 0)
+        unlink(tmpPath.c_str());
+    dirty = false;
+}
+
+/* Fill in the values of a desktop entry from the cache. Return false if the 
+ * entry isn't cached or the file has changed since it was cached */
+bool ParseCache::fetch(DesktopFile *df)
+{
+    if (!enabled) return false;
+    std::map<std::string, CachedEntry>::iterator it = entries.find(df->filename);
+    if (it == entries.end()) return false;
+    struct stat st;
+    if (stat(df->filename.c_str(), &st) != 0) return false;
+    CachedEntry& entry = it->second;
+    if (entry.mtime != st.st_mtime || entry.mtimeNsec != st.st_mtim.tv_nsec ||
+            entry.size != st.st_size)
+        return false;
+    df->name = entry.name;
+    df->exec = entry.exec;
+    df->iconDef = entry.icon;
+    df->tryExec = entry.tryExec;
+    df->nodisplay = entry.nodisplay;
+    df->terminal = entry.terminal;
+    df->hidden = entry.hidden;
+    df->foundCategories = entry.categories;
+    df->onlyShowInDesktops = entry.onlyShowIn;
+    entry.used = true;
+    return true;
+}
+
+/* Remember the values just read from a desktop entry */
+void ParseCache::store(DesktopFile *df)
+{
+    if (!enabled) return;
+    struct stat st;
+    if (stat(df->filename.c_str(), &st) != 0) return;
+    CachedEntry& entry = entries[df->filename];
+    entry.mtime = st.st_mtime;
+    entry.mtimeNsec = st.st_mtim.tv_nsec;
+    entry.size = st.st_size;
+    entry.used = true;
+    entry.name = df->name;
+    entry.exec = df->exec;
+    entry.icon = df->iconDef;
+    entry.tryExec = df->tryExec;
+    entry.nodisplay = df->nodisplay;
+    entry.terminal = df->terminal;
+    entry.hidden = df->hidden;
+    entry.categories = df->foundCategories;
+    entry.onlyShowIn = df->onlyShowInDesktops;
+    dirty = true;
+}
+
+/* Read the names in a directory, noting which are directories we should 
+ * descend into. Symlinks to directories are skipped, as they are by a
+ * recursive directory iterator */
+bool ParseCache::readDir(const std::string& dir, CachedDir& listing)
+{
+    try
+    {
+        for (boost::filesystem::directory_iterator i(dir), end; i != end; ++i)
+        {
+            bool isDir = is_directory(i->path());
+            if (isDir && is_symlink(i->path())) continue;
+            listing.names.push_back(i->path().filename().string());
+            listing.isDir.push_back(isDir);
+        }
+    }
+    catch (boost::filesystem::filesystem_error&)
+    {
+        return false;
+    }
+    return true;
+}
+
+/* Read the names in a directory without looking at what each one is. This
+ * is a single pass over the directory with no per name stat */
+bool ParseCache::readNames(const std::string& dir, CachedDir& listing)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL) return false;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL)
+    {
+        if (entry->d_type == DT_DIR) continue;
+        if (entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || 
+                (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+            continue;
+        listing.names.push_back(entry->d_name);
+        listing.isDir.push_back(false);
+    }
+    closedir(d);
+    return true;
+}
+
+/* Point listing at the listing of a directory, from the cache if the 
+ * directory hasn't changed since it was cached and read from disk (into
+ * uncached) otherwise. Return false if the directory can't be read */
+bool ParseCache::findListing(std::map<std::string, CachedDir>& listings,
+        const std::string& dir, bool recursive, CachedDir& uncached, 
+        CachedDir *&listing)
+{
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+
+    listing = &uncached;
+    if (enabled)
+    {
+        std::map<std::string, CachedDir>::iterator it = listings.find(dir);
+        if (it != listings.end() && it->second.mtime == st.st_mtime && 
+                it->second.mtimeNsec == st.st_mtim.tv_nsec)
+        {
+            listing = &it->second;
+        }
+        else
+        {
+            if (recursive && !readDir(dir, uncached)) return false;
+            if (!recursive && !readNames(dir, uncached)) return false;
+            uncached.mtime = st.st_mtime;
+            uncached.mtimeNsec = st.st_mtim.tv_nsec;
+            listing = &listings[dir];
+            *listing = uncached;
+            dirty = true;
+        }
+        listing->used = true;
+        return true;
+    }
+    if (recursive) return readDir(dir, uncached);
+    return readNames(dir, uncached);
+}
+
+/* Add the paths of all files below a directory to files, in the same order
+ * as a recursive directory iterator would. A directory is only read if its 
+ * modification time differs from the cached one */
+void ParseCache::listFiles(const std::string& dir, std::vector<std::string>& files)
+{
+    CachedDir uncached;
+    CachedDir *listing;
+    if (!findListing(dirs, dir, true, uncached, listing)) return;
+
+    for (unsigned int x = 0; x < listing->names.size(); x++)
+    {
+        std::string path = 
+            (boost::filesystem::path(dir) / listing->names[x]).string();
+        if (listing->isDir[x]) listFiles(path, files);
+        else files.push_back(path);
+    }
+}
+
+/* Add the names of everything but subdirectories in a directory to names */
+void ParseCache::listNames(const std::string& dir, std::vector<std::string>& names)
+{
+    CachedDir uncached;
+    CachedDir *listing;
+    if (!findListing(nameLists, dir, false, uncached, listing)) return;
+    names.insert(names.end(), listing->names.begin(), listing->names.end());
+}
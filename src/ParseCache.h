@@ -0,0 +1,89 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PARSE_CACHE_H_
+#define _PARSE_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+class DesktopFile;
+
+#define PARSE_CACHE_MAGIC "MWMCACHE"
+#define PARSE_CACHE_VERSION 2
+
+//The values read from a desktop entry, before any processing is done
+struct CachedEntry
+{   int64_t mtime;
+    int64_t mtimeNsec;
+    int64_t size;
+    bool used;
+    std::string name;
+    std::string exec;
+    std::string icon;
+    std::string tryExec;
+    bool nodisplay;
+    bool terminal;
+    bool hidden;
+    std::vector<std::string> categories;
+    std::vector<std::string> onlyShowIn;
+};
+
+//The names in a directory, in the order they were read
+struct CachedDir
+{   int64_t mtime;
+    int64_t mtimeNsec;
+    bool used;
+    std::vector<std::string> names;
+    std::vector<bool> isDir;
+};
+
+class ParseCache
+{
+    public:
+        ParseCache(const std::string& cacheFile, bool enabled);
+
+        bool fetch(DesktopFile *df);
+        void store(DesktopFile *df);
+        void listFiles(const std::string& dir, std::vector<std::string>& files);
+        void listNames(const std::string& dir, std::vector<std::string>& names);
+        void save();
+
+        static std::string defaultPath(const std::string& homedir);
+
+    private:
+        std::string cacheFile;
+        bool enabled;
+        bool dirty;
+        std::map<std::string, CachedEntry> entries;
+        std::map<std::string, CachedDir> dirs;
+        std::map<std::string, CachedDir> nameLists;
+
+        void load();
+        bool readDir(const std::string& dir, CachedDir& listing);
+        bool readNames(const std::string& dir, CachedDir& listing);
+        bool findListing(std::map<std::string, CachedDir>& listings, 
+                const std::string& dir, bool recursive, CachedDir& uncached,
+                CachedDir *&listing);
+};
+
+#endif
@@ -0,0 +1,480 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include "RunConfig.h"
+#include "DesktopFile.h"
+#include "Deadline.h"
+
+#define GET_COMMA_VALUES(X) DesktopFile::getMultiValue(X, ',', '\0')
+
+RunConfig::RunConfig(int argc, char *argv[]) :
+    valid(true),
+    help(false),
+    term("xterm -e"),
+    menuName("Applications"),
+    windowmanager(mwm),
+    useIcons(false),
+    iconsXdgOnly(false),
+    iconsXdgSize("all"),
+    iconSize(0),
+    maxItems(0),
+    deadline(0),
+    jobs(1),
+    showFromDesktops(1, "none"),
+    noCustomCats(false),
+    useCache(true),
+    checkExec(false),
+    ifChanged(false),
+    ioUring(false),
+    keepDuplicates(false),
+    lazy(false),
+    entryIcons(false)
+{
+    const char *home = getenv("HOME");
+    if (home != NULL) homedir = home;
+    parse(argc, argv);
+    if (valid && !help) finish(argc, argv);
+}
+
+//Split a comma separated list into a hash set
+NameSet RunConfig::nameSet(const char *values)
+{
+    std::vector<std::string> names = GET_COMMA_VALUES(values);
+    return NameSet(names.begin(), names.end());
+}
+
+/* Read the options from the command line */
+void RunConfig::parse(int argc, char *argv[])
+{
+    for (int x = 0; x < argc; x++)
+    {
+        if (strcmp(argv[x], "-h") == 0 || strcmp(argv[x], "--help") == 0)
+        {
+            help = true;
+            return;
+        }
+        if (strcmp(argv[x], "-n") == 0 || strcmp(argv[x], "--name") == 0) 
+        {
+            if (x + 1 < argc) menuName = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "-i") == 0 || strcmp(argv[x], "--icons") == 0)
+        {
+            useIcons = true;
+            continue;
+        }
+        if (strcmp(argv[x], "-t") == 0 || strcmp(argv[x], "--terminal") == 0)
+        {
+            if (x + 1 < argc) 
+            {
+                term = argv[x + 1];
+                term += " -e";
+            }
+            continue;
+        }
+        if (strcmp(argv[x], "--icons-xdg-only") == 0) 
+        {  
+            iconsXdgOnly = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--icons-xdg-size") == 0) 
+        {  
+            if (x + 1 < argc) iconsXdgSize = argv[x + 1] ;
+            continue;
+        }
+        if (strcmp(argv[x], "--icon-size") == 0) 
+        {  
+            if (x + 1 < argc) iconSize = atoi(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--fvwm") == 0) 
+        {  
+            windowmanager = fvwm;
+            continue;
+        }
+        if (strcmp(argv[x], "--fvwm-dynamic") == 0) 
+        {  
+            windowmanager = fvwm_dynamic;
+            continue;
+        }
+        if (strcmp(argv[x], "--fluxbox") == 0) 
+        {  
+            windowmanager = fluxbox;
+            continue;
+        }
+        if (strcmp(argv[x], "--openbox") == 0) 
+        {  
+            windowmanager = openbox;
+            continue;
+        }
+        if (strcmp(argv[x], "--openbox-pipe") == 0) 
+        {  
+            windowmanager = openbox_pipe;
+            continue;
+        }
+        if (strcmp(argv[x], "--olvwm") == 0) 
+        {  
+            windowmanager = olvwm;
+            continue;
+        }
+        if (strcmp(argv[x], "--windowmaker") == 0) 
+        {  
+            windowmanager = windowmaker;
+            continue;
+        }
+        if (strcmp(argv[x], "--icewm") == 0) 
+        {  
+            windowmanager = icewm;
+            continue;
+        }
+        if (strcmp(argv[x], "--emit") == 0) 
+        {  
+            if (x + 1 < argc)
+            {
+                std::string emit = argv[x + 1];
+                WindowManager format;
+                if (emit.find('=') == std::string::npos || 
+                        !getWindowManager(emit.substr(0, emit.find('=')), format))
+                {
+                    std::cerr << "mwmmenu: invalid --emit argument: " << emit 
+                        << std::endl;
+                    valid = false;
+                    return;
+                }
+                emitFormats.push_back(format);
+                emitPaths.push_back(emit.substr(emit.find('=') + 1));
+            }
+            continue;
+        }
+        if (strcmp(argv[x], "--exclude") == 0) 
+        {  
+            if (x + 1 < argc) exclude = nameSet(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--exclude-matching") == 0) 
+        {  
+            if (x + 1 < argc) excludeMatching = GET_COMMA_VALUES(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--exclude-categories") == 0) 
+        {  
+            if (x + 1 < argc) excludeCategories = nameSet(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--exclude-by-filename") == 0)
+        {  
+            if (x + 1 < argc) excludedFilenames = nameSet(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--include") == 0)
+        {  
+            if (x + 1 < argc) include = nameSet(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--show-from-desktops") == 0)
+        {  
+            if (x + 1 < argc) showFromDesktops = GET_COMMA_VALUES(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--add-desktop-paths") == 0) 
+        {  
+            if (x + 1 < argc) extraDesktopPaths = GET_COMMA_VALUES(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--add-icon-paths") == 0) 
+        {  
+            if (x + 1 < argc) extraIconPaths = GET_COMMA_VALUES(argv[x + 1]);
+            continue;
+        }
+        if (strcmp(argv[x], "--save-model") == 0) 
+        {  
+            if (x + 1 < argc) saveModel = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "--load-model") == 0) 
+        {  
+            if (x + 1 < argc) loadModel = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "--max-items") == 0) 
+        {  
+            if (x + 1 < argc) maxItems = atoi(argv[x + 1]);
+            if (maxItems <= 0)
+            {
+                std::cerr << "mwmmenu: --max-items needs a number above 0" 
+                    << std::endl;
+                valid = false;
+                return;
+            }
+            continue;
+        }
+        if (strcmp(argv[x], "--max-line-length") == 0) 
+        {  
+            if (!parseLimit(argc, argv, x, limits.maxLine)) return;
+            continue;
+        }
+        if (strcmp(argv[x], "--max-file-size") == 0) 
+        {  
+            if (!parseLimit(argc, argv, x, limits.maxFileSize)) return;
+            continue;
+        }
+        if (strcmp(argv[x], "--max-menu-depth") == 0) 
+        {  
+            if (!parseLimit(argc, argv, x, limits.maxMenuDepth)) return;
+            continue;
+        }
+        if (strcmp(argv[x], "--max-entries") == 0) 
+        {  
+            if (!parseLimit(argc, argv, x, limits.maxEntries)) return;
+            continue;
+        }
+        if (strcmp(argv[x], "--jobs") == 0) 
+        {  
+            if (x + 1 < argc) jobs = atoi(argv[x + 1]);
+            if (jobs <= 0)
+            {
+                std::cerr << "mwmmenu: --jobs needs a number above 0" 
+                    << std::endl;
+                valid = false;
+                return;
+            }
+            continue;
+        }
+        if (strcmp(argv[x], "--category") == 0) 
+        {  
+            if (x + 1 < argc) onlyCategory = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "--lazy") == 0)
+        {  
+            lazy = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--check-exec") == 0)
+        {  
+            checkExec = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--deadline") == 0) 
+        {  
+            if (x + 1 < argc) deadline = atoi(argv[x + 1]);
+            if (deadline <= 0)
+            {
+                std::cerr << "mwmmenu: --deadline needs a number of "
+                    "milliseconds above 0" << std::endl;
+                valid = false;
+                return;
+            }
+            continue;
+        }
+        if (strcmp(argv[x], "--delta") == 0) 
+        {  
+            if (x + 1 < argc) deltaState = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "--if-changed") == 0)
+        {  
+            ifChanged = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--search-index") == 0) 
+        {  
+            if (x + 1 < argc) searchIndex = argv[x + 1];
+            continue;
+        }
+        if (strcmp(argv[x], "--keep-duplicates") == 0)
+        {  
+            keepDuplicates = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--io-uring") == 0)
+        {  
+            ioUring = true;
+            continue;
+        }
+        if (strcmp(argv[x], "--no-cache") == 0)
+        {  
+            useCache = false;
+            continue;
+        }
+        if (strcmp(argv[x], "--no-custom-categories") == 0)
+        {  
+            noCustomCats = true;
+            continue;
+        }
+    }
+}
+
+/* Work out the settings which depend on more than one option */
+void RunConfig::finish(int argc, char *argv[])
+{
+    //With a deadline, a copy of mwmmenu is run with the same options but 
+    //without the deadline
+    if (deadline > 0)
+    {
+        for (int x = 0; x < argc; x++)
+        {
+            if (strcmp(argv[x], "--deadline") == 0) x++;
+            else deadlineArgs.push_back(argv[x]);
+        }
+    }
+    if (emitFormats.empty())
+    {
+        emitFormats.push_back(windowmanager);
+        emitPaths.push_back("-");
+    }
+    //A delta is worked out against the last menu written, so there can only
+    //be one menu
+    if (deltaState != "" && (emitFormats.size() != 1 || 
+            (emitFormats[0] != fvwm && emitFormats[0] != fvwm_dynamic)))
+    {
+        std::cerr << "mwmmenu: --delta needs a single fvwm or fvwm-dynamic menu" 
+            << std::endl;
+        valid = false;
+        return;
+    }
+    //Only look for icons if at least one of the menus can show them or if
+    //they are wanted in a saved model
+    bool iconsWanted = saveModel != "";
+    for (unsigned int x = 0; x < emitFormats.size(); x++)
+        if (supportsIcons(emitFormats[x])) iconsWanted = true;
+    if (!iconsWanted) useIcons = false;
+    if (iconsXdgSize == "all") iconsXdgSize = "/";
+    //Lazy menus are only possible for Openbox pipe menus. The top level pipe
+    //menu runs mwmmenu again, with the same options, for each category
+    if (lazy && onlyCategory == "" && saveModel == "" &&
+            emitFormats.size() == 1 && emitFormats[0] == openbox_pipe)
+    {
+        //The options which say where this run's output goes are left out, 
+        //as each pipe menu writes only its category to Openbox
+        pipeCommand = shellQuote(argv[0]);
+        for (int x = 1; x < argc; x++)
+        {
+            if (strcmp(argv[x], "--emit") == 0 || 
+                    strcmp(argv[x], "--delta") == 0 ||
+                    strcmp(argv[x], "--search-index") == 0) x++;
+            else if (strcmp(argv[x], "--lazy") != 0 &&
+                    strcmp(argv[x], "--if-changed") != 0)
+                pipeCommand += " " + shellQuote(argv[x]);
+        }
+        //If the format was only given with --emit, give it on its own
+        if (windowmanager != openbox_pipe) pipeCommand += " --openbox-pipe";
+        //If we are making the menu for a run with a deadline, the pipe menus
+        //get the same deadline
+        const char *deadlineMs = getenv(DEADLINE_VARIABLE);
+        if (deadlineMs != NULL) 
+            pipeCommand += " --deadline " + shellQuote(deadlineMs);
+    }
+    //The icons of entries are only needed if they are written here rather 
+    //than in pipe menus
+    entryIcons = useIcons && pipeCommand == "";
+}
+
+/* Read the number after one of the --max- limit options, which must be above
+ * 0. Returns false, with valid false, if it isn't */
+bool RunConfig::parseLimit(int argc, char *argv[], int x, unsigned int& limit)
+{
+    int value = 0;
+    if (x + 1 < argc) value = atoi(argv[x + 1]);
+    if (value <= 0)
+    {
+        std::cerr << "mwmmenu: " << argv[x] << " needs a number above 0" 
+            << std::endl;
+        valid = false;
+        return false;
+    }
+    limit = value;
+    return true;
+}
+
+//Return whether any of the entry filters were given
+bool RunConfig::filtersEntries() const
+{
+    return !exclude.empty() || !excludeMatching.empty() || 
+        !excludedFilenames.empty() || !include.empty();
+}
+
+//Return whether --exclude, --exclude-matching or --exclude-by-filename 
+//exclude an entry
+bool RunConfig::entryExcluded(const std::string& name, 
+        const std::string& filename) const
+{
+    if (exclude.find(name) != exclude.end()) return true;
+    for (unsigned int x = 0; x < excludeMatching.size(); x++)
+        if (name.find(excludeMatching[x]) != std::string::npos) return true;
+    return excludedFilenames.find(filename) != excludedFilenames.end();
+}
+
+//Return whether --include includes an entry
+bool RunConfig::entryIncluded(const std::string& name) const
+{
+    return include.find(name) != include.end();
+}
+
+//Map a format name as given to --emit to a window manager id. Return false
+//if the name is not known
+bool RunConfig::getWindowManager(const std::string& format, 
+        WindowManager& windowmanager)
+{
+    const char *formats[] = {"mwm", "fvwm", "fvwm-dynamic", "fluxbox", 
+        "openbox", "openbox-pipe", "olvwm", "windowmaker", "icewm"};
+    const WindowManager wms[] = {mwm, fvwm, fvwm_dynamic, fluxbox, openbox,
+        openbox_pipe, olvwm, windowmaker, icewm};
+    for (unsigned int x = 0; x < sizeof(formats) / sizeof(*formats); x++)
+    {
+        if (format == formats[x])
+        {
+            windowmanager = wms[x];
+            return true;
+        }
+    }
+    if (format == "twm")
+    {
+        windowmanager = mwm;
+        return true;
+    }
+    return false;
+}
+
+//Return whether a window manager can display icons in menus
+bool RunConfig::supportsIcons(WindowManager windowmanager)
+{
+    return !(windowmanager == mwm || 
+            windowmanager == olvwm ||
+            windowmanager == windowmaker);
+}
+
+//Quote an argument for the shell if it needs it
+std::string RunConfig::shellQuote(const std::string& arg)
+{
+    if (!arg.empty() && arg.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_./=,:+@%") == std::string::npos)
+        return arg;
+    std::string quoted = "'";
+    for (unsigned int x = 0; x < arg.size(); x++)
+    {
+        if (arg[x] == '\'') quoted += "'\\''";
+        else quoted += arg[x];
+    }
+    return quoted + "'";
+}
@@ -0,0 +1,137 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUN_CONFIG_H_
+#define _RUN_CONFIG_H_
+
+#include <string>
+#include <vector>
+#include <boost/unordered_set.hpp>
+
+//WM id numbers
+enum WindowManager
+{
+    mwm = 0,
+    fvwm,
+    fvwm_dynamic,
+    fluxbox,
+    openbox,
+    openbox_pipe,
+    olvwm,
+    windowmaker,
+    icewm
+};
+
+typedef boost::unordered_set<std::string> NameSet;
+
+#define DEFAULT_MAX_LINE 65536
+#define DEFAULT_MAX_FILE_SIZE 1048576
+#define DEFAULT_MAX_MENU_DEPTH 32
+#define DEFAULT_MAX_ENTRIES 50000
+
+/* Bounds on what is read, so broken or hostile desktop entries, .directory 
+ * and .menu files can't make a run take unbounded memory, time or stack. 
+ * Files over a bound are skipped with a message */
+struct InputLimits
+{   unsigned int maxLine;
+    unsigned int maxFileSize;
+    unsigned int maxMenuDepth;
+    unsigned int maxEntries;
+
+    InputLimits() :
+        maxLine(DEFAULT_MAX_LINE),
+        maxFileSize(DEFAULT_MAX_FILE_SIZE),
+        maxMenuDepth(DEFAULT_MAX_MENU_DEPTH),
+        maxEntries(DEFAULT_MAX_ENTRIES) {}
+};
+
+/* The options for a run, parsed once from the command line. Lists given as 
+ * comma separated strings are split when parsing, and the lists that are 
+ * looked things up in are kept as hash sets. A RunConfig is made const once 
+ * parsed and passed by reference to the code that builds and writes the 
+ * menus */
+class RunConfig
+{
+    public:
+        RunConfig(int argc, char *argv[]);
+
+        //False if the command line couldn't be parsed. An error has been 
+        //printed
+        bool valid;
+        bool help;
+
+        std::string homedir;
+        std::string term;
+        std::string menuName;
+        WindowManager windowmanager;
+        bool useIcons;
+        bool iconsXdgOnly;
+        std::string iconsXdgSize;
+        int iconSize;
+        int maxItems;
+        int deadline;
+        int jobs;
+        NameSet exclude;
+        std::vector<std::string> excludeMatching;
+        NameSet excludeCategories;
+        NameSet excludedFilenames;
+        NameSet include;
+        std::vector<std::string> showFromDesktops;
+        std::vector<std::string> extraDesktopPaths;
+        std::vector<std::string> extraIconPaths;
+        bool noCustomCats;
+        bool useCache;
+        bool checkExec;
+        bool ifChanged;
+        bool ioUring;
+        bool keepDuplicates;
+        std::string deltaState;
+        std::string searchIndex;
+        std::vector<WindowManager> emitFormats;
+        std::vector<std::string> emitPaths;
+        std::string saveModel;
+        std::string onlyCategory;
+        bool lazy;
+        std::string loadModel;
+        InputLimits limits;
+
+        //Worked out from the options above
+        bool entryIcons;
+        std::string pipeCommand;
+        std::vector<std::string> deadlineArgs;
+
+        bool filtersEntries() const;
+        bool entryExcluded(const std::string& name, 
+                const std::string& filename) const;
+        bool entryIncluded(const std::string& name) const;
+
+        static bool getWindowManager(const std::string& format, 
+                WindowManager& windowmanager);
+        static bool supportsIcons(WindowManager windowmanager);
+        static std::string shellQuote(const std::string& arg);
+
+    private:
+        void parse(int argc, char *argv[]);
+        void finish(int argc, char *argv[]);
+        bool parseLimit(int argc, char *argv[], int x, unsigned int& limit);
+        static NameSet nameSet(const char *values);
+};
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "SearchIndex.h"
+#include "CategoryTree.h"
+#include "EntryTable.h"
+
+//Add a string to the pool, unless it's already there, and return its offset
+static uint32_t poolString(const std::string& str, std::string& pool, 
+        std::map<std::string, uint32_t>& pooled)
+{
+    std::map<std::string, uint32_t>::iterator it = pooled.find(str);
+    if (it != pooled.end()) return it->second;
+    uint32_t offset = pool.size();
+    pool.append(str);
+    pool.push_back('\0');
+    pooled[str] = offset;
+    return offset;
+}
+
+//Add the name of a top level category to the categories of the entries in 
+//a category and its shown subcategories. lastTop is the top level category 
+//each entry was last given, so it isn't given the same one twice
+static void collectEntries(const CategoryTree& tree, unsigned int node, 
+        unsigned int top, std::vector<std::string>& categories,
+        std::vector<unsigned int>& lastTop)
+{
+    for (std::vector<unsigned int>::const_iterator it = tree.membersBegin(node); 
+            it < tree.membersEnd(node); it++)
+    {
+        if (lastTop[*it] == top) continue;
+        lastTop[*it] = top;
+        if (categories[*it] != "") categories[*it] += ";";
+        categories[*it] += tree.name(top);
+    }
+    for (unsigned int sub = tree.firstChild(node); sub != NO_CATEGORY_NODE; 
+            sub = tree.nextSibling(sub))
+        if (tree.visible(sub)) collectEntries(tree, sub, top, categories, lastTop);
+}
+
+//Orders records by key, then by name and exec line so the order is fixed
+struct RecordCompare
+{   const std::string *pool;
+
+    RecordCompare(const std::string *pool) : pool(pool) {}
+    bool operator()(const SearchIndexRecord& a, const SearchIndexRecord& b) const
+    {
+        const char *strings = pool->c_str();
+        int result = strcmp(strings + a.key, strings + b.key);
+        if (result == 0) result = strcmp(strings + a.name, strings + b.name);
+        if (result == 0) result = strcmp(strings + a.exec, strings + b.exec);
+        return result < 0;
+    }
+};
+
+/* Write the entries shown in the menu as a search index. The index is 
+ * written to a temporary file which is then renamed, so launchers never see
+ * half an index */
+bool SearchIndex::save(const std::string& path, const CategoryTree& tree,
+        const EntryTable& entries)
+{
+    std::vector<std::string> categories(entries.size());
+    std::vector<unsigned int> lastTop(entries.size(), NO_CATEGORY_NODE);
+    std::vector<unsigned int> roots = tree.roots();
+    for (unsigned int x = 0; x < roots.size(); x++)
+        collectEntries(tree, roots[x], roots[x], categories, lastTop);
+
+    std::string pool(1, '\0');
+    std::map<std::string, uint32_t> pooled;
+    pooled[""] = 0;
+    std::vector<SearchIndexRecord> records;
+    for (unsigned int x = 0; x < entries.size(); x++)
+    {
+        if (categories[x] == "") continue;
+        std::string key = entries.name(x);
+        for (unsigned int y = 0; y < key.size(); y++) key[y] = tolower(key[y]);
+        SearchIndexRecord record;
+        record.key = poolString(key, pool, pooled);
+        record.name = poolString(entries.name(x), pool, pooled);
+        record.exec = poolString(entries.execPrefix(x) + entries.exec(x), 
+                pool, pooled);
+        record.icon = poolString(entries.icon(x), pool, pooled);
+        record.categories = poolString(categories[x], pool, pooled);
+        records.push_back(record);
+    }
+    sort(records.begin(), records.end(), RecordCompare(&pool));
+    //Keep every table 4 byte aligned
+    while (pool.size() % 4 != 0) pool.push_back('\0');
+
+    std::vector<uint32_t> firstRecord(SEARCH_INDEX_FIRST_BYTES);
+    unsigned int record = 0;
+    for (unsigned int byte = 0; byte < SEARCH_INDEX_FIRST_BYTES; byte++)
+    {
+        while (record < records.size() && 
+                (unsigned char)pool[records[record].key] < byte)
+            record++;
+        firstRecord[byte] = record;
+    }
+
+    SearchIndexHeader header;
+    memcpy(header.magic, SEARCH_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SEARCH_INDEX_VERSION;
+    header.byteOrder = SEARCH_INDEX_BYTE_ORDER;
+    header.recordCount = records.size();
+    header.stringsSize = pool.size();
+
+    std::ostringstream tmpName;
+    tmpName << path << "." << getpid() << ".tmp";
+    std::string tmpPath = tmpName.str();
+    std::ofstream index_f(tmpPath.c_str(), 
+            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!index_f) return false;
+    index_f.write((const char*)&header, sizeof(header));
+    index_f.write((const char*)&firstRecord[0], 
+            firstRecord.size() * sizeof(uint32_t));
+    if (!records.empty())
+        index_f.write((const char*)&records[0], 
+                records.size() * sizeof(SearchIndexRecord));
+    index_f.write(pool.data(), pool.size());
+    index_f.close();
+    if (!index_f || rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SEARCH_INDEX_H_
+#define _SEARCH_INDEX_H_
+
+#include <stdint.h>
+#include <string>
+
+class CategoryTree;
+class EntryTable;
+
+/* A search index is for launchers, which can map it and look up entries by 
+ * the start of their names without reading any desktop entries. It holds the
+ * entries shown in the menu and is laid out as the header, the first byte 
+ * table, the record table and the string pool. Every table is made of 32 bit
+ * fields and strings are nul terminated and referenced by their offset into 
+ * the pool. Records are sorted by key, which is the name of the entry in 
+ * lower case, so the entries whose names start with a prefix are a run of 
+ * records which can be found by binary search. The first byte table narrows 
+ * the search: the records whose keys start with the byte b are those from 
+ * firstRecord[b] up to firstRecord[b + 1]. Categories are the top level 
+ * categories holding the entry, separated by semicolons, and exec lines 
+ * include the terminal command if the entry needs one */
+#define SEARCH_INDEX_MAGIC "MWMINDEX"
+#define SEARCH_INDEX_VERSION 1
+#define SEARCH_INDEX_BYTE_ORDER 0x01020304
+#define SEARCH_INDEX_FIRST_BYTES 257
+
+struct SearchIndexHeader
+{   char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t recordCount;
+    uint32_t stringsSize;
+};
+
+struct SearchIndexRecord
+{   uint32_t key;
+    uint32_t name;
+    uint32_t exec;
+    uint32_t icon;
+    uint32_t categories;
+};
+
+class SearchIndex
+{
+    public:
+        static bool save(const std::string& path, const CategoryTree& tree,
+                const EntryTable& entries);
+};
+
+#endif
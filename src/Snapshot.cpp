@@ -0,0 +1,277 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Snapshot.h"
+#include "Category.h"
+#include "EntryTable.h"
+
+//Add a string to the pool, unless it's already there, and return its offset
+static uint32_t poolString(const std::string& str, std::string& pool, 
+        std::map<std::string, uint32_t>& pooled)
+{
+    std::map<std::string, uint32_t>::iterator it = pooled.find(str);
+    if (it != pooled.end()) return it->second;
+    uint32_t offset = pool.size();
+    pool.append(str);
+    pool.push_back('\0');
+    pooled[str] = offset;
+    return offset;
+}
+
+//Add a category and its subcategories to the category table in pre-order
+static void flattenCategory(Category *cat, uint32_t parent, 
+        std::vector<SnapshotCategory>& categories, std::vector<uint32_t>& members,
+        const EntryTable& entries, std::string& pool,
+        std::map<std::string, uint32_t>& pooled)
+{
+    uint32_t index = categories.size();
+    SnapshotCategory sc;
+    sc.name = poolString(cat->name, pool, pooled);
+    sc.icon = poolString(cat->icon, pool, pooled);
+    sc.depth = cat->depth;
+    sc.flags = cat->nodisplay ? SNAPSHOT_NODISPLAY : 0;
+    sc.parent = parent;
+    sc.subtreeSize = 0;
+    sc.firstMember = members.size();
+    std::vector<unsigned int> rows = cat->getEntries(entries);
+    members.insert(members.end(), rows.begin(), rows.end());
+    sc.memberCount = members.size() - sc.firstMember;
+    categories.push_back(sc);
+
+    std::vector<Category*> subCats = cat->getSubcats();
+    for (unsigned int x = 0; x < subCats.size(); x++)
+        flattenCategory(subCats[x], index, categories, members, entries, 
+                pool, pooled);
+    categories[index].subtreeSize = categories.size() - index - 1;
+}
+
+/* Write the model out as a snapshot. The snapshot is written to a temporary 
+ * file first and then renamed, so a reader never sees a partial snapshot */
+bool Snapshot::save(const std::string& path, const std::vector<Category*>& cats,
+        const EntryTable& entries)
+{
+    //Category strings are pooled after the strings of the entry table
+    std::string pool(entries.pool.begin(), entries.pool.end());
+    std::map<std::string, uint32_t> pooled;
+    std::vector<SnapshotEntry> entryTable;
+    std::vector<SnapshotCategory> categories;
+    std::vector<uint32_t> members;
+
+    entryTable.resize(entries.size());
+    for (unsigned int x = 0; x < entries.size(); x++)
+    {
+        entryTable[x].filename = entries.filenames[x];
+        entryTable[x].name = entries.names[x];
+        entryTable[x].exec = entries.execs[x];
+        entryTable[x].icon = entries.icons[x];
+        entryTable[x].flags = entries.flags[x];
+    }
+    for (unsigned int x = 0; x < cats.size(); x++)
+        flattenCategory(cats[x], SNAPSHOT_NO_PARENT, categories, members, 
+                entries, pool, pooled);
+    //Keep every table 4 byte aligned
+    while (pool.size() % 4 != 0) pool.push_back('\0');
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.entryCount = entryTable.size();
+    header.categoryCount = categories.size();
+    header.memberCount = members.size();
+    header.stringsSize = pool.size();
+
+    std::ostringstream tmpName;
+    tmpName << path << "." << getpid() << ".tmp";
+    std::string tmpPath = tmpName.str();
+    std::ofstream snapshot_f(tmpPath.c_str(), 
+            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!snapshot_f) return false;
+    snapshot_f.write((const char*)&header, sizeof(header));
+    if (!entryTable.empty())
+        snapshot_f.write((const char*)&entryTable[0], 
+                entryTable.size() * sizeof(SnapshotEntry));
+    if (!categories.empty())
+        snapshot_f.write((const char*)&categories[0], 
+                categories.size() * sizeof(SnapshotCategory));
+    if (!members.empty())
+        snapshot_f.write((const char*)&members[0], 
+                members.size() * sizeof(uint32_t));
+    snapshot_f.write(pool.data(), pool.size());
+    snapshot_f.close();
+    if (!snapshot_f || rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* Map a snapshot and check that it is one we can use: the magic, version 
+ * and byte order must match, the tables must exactly fill the file and the 
+ * string pool must end in a nul, so any offset into the pool is a complete 
+ * string */
+static const char *mapSnapshot(const std::string& path, size_t& size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size = st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    const SnapshotHeader *header = (const SnapshotHeader*)data;
+    uint64_t needed = sizeof(SnapshotHeader) + 
+        (uint64_t)header->entryCount * sizeof(SnapshotEntry) +
+        (uint64_t)header->categoryCount * sizeof(SnapshotCategory) +
+        (uint64_t)header->memberCount * sizeof(uint32_t) + 
+        header->stringsSize;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != SNAPSHOT_VERSION || 
+            header->byteOrder != SNAPSHOT_BYTE_ORDER || needed != size ||
+            header->stringsSize == 0 || 
+            ((const char*)data)[size - 1] != '\0')
+    {
+        munmap(data, size);
+        return NULL;
+    }
+    return (const char*)data;
+}
+
+/* Load a snapshot written by save(). Top level categories are added to cats
+ * and the entries are put in entries, which should be empty. The writers 
+ * work on Category objects and an EntryTable, so these are rebuilt from the
+ * mapped tables rather than rendered from them in place. Every string 
+ * offset, member index, parent, subtree size and depth is checked before it 
+ * is used, and nothing is kept if any of them is out of range */
+bool Snapshot::load(const std::string& path, std::vector<Category*>& cats,
+        EntryTable& entries)
+{
+    size_t size;
+    const char *data = mapSnapshot(path, size);
+    if (data == NULL) return false;
+
+    const SnapshotHeader *header = (const SnapshotHeader*)data;
+    const SnapshotEntry *entryTable = 
+        (const SnapshotEntry*)(data + sizeof(SnapshotHeader));
+    const SnapshotCategory *categories = 
+        (const SnapshotCategory*)(entryTable + header->entryCount);
+    const uint32_t *members = 
+        (const uint32_t*)(categories + header->categoryCount);
+    const char *strings = (const char*)(members + header->memberCount);
+    uint32_t stringsSize = header->stringsSize;
+    bool valid = strings[0] == '\0';
+
+    EntryTable loaded;
+    loaded.pool.assign(strings, strings + stringsSize);
+    loaded.filenames.reserve(header->entryCount);
+    loaded.basenames.reserve(header->entryCount);
+    loaded.names.reserve(header->entryCount);
+    loaded.execs.reserve(header->entryCount);
+    loaded.icons.reserve(header->entryCount);
+    loaded.flags.reserve(header->entryCount);
+    loaded.categoryCounts.reserve(header->entryCount);
+    for (uint32_t x = 0; x < header->entryCount && valid; x++)
+    {
+        const SnapshotEntry& se = entryTable[x];
+        if (se.filename >= stringsSize || se.name >= stringsSize ||
+                se.exec >= stringsSize || se.icon >= stringsSize)
+        {
+            valid = false;
+            break;
+        }
+        const char *filename = strings + se.filename;
+        const char *slash = strrchr(filename, '/');
+        loaded.filenames.push_back(se.filename);
+        loaded.basenames.push_back(slash == NULL ? se.filename : 
+                se.filename + (slash - filename) + 1);
+        loaded.names.push_back(se.name);
+        loaded.execs.push_back(se.exec);
+        loaded.icons.push_back(se.icon);
+        loaded.flags.push_back(se.flags & (ENTRY_NODISPLAY | ENTRY_TERMINAL));
+        loaded.categoryCounts.push_back(0);
+    }
+    loaded.categoryIds.resize(loaded.size() * MAX_ENTRY_CATEGORIES, NO_CATEGORY);
+
+    std::vector<Category*> loadedCats;
+    std::vector<Category*> topCats;
+    loadedCats.reserve(header->categoryCount);
+    std::vector<IconSpec> noIcons;
+    for (uint32_t x = 0; x < header->categoryCount && valid; x++)
+    {
+        const SnapshotCategory& sc = categories[x];
+        //A category must lie within its parent's subtree, one level below it
+        bool placed = sc.parent == SNAPSHOT_NO_PARENT ? sc.depth == 0 :
+            sc.parent < x && 
+            x - sc.parent <= categories[sc.parent].subtreeSize &&
+            sc.depth == categories[sc.parent].depth + 1;
+        if (sc.name >= stringsSize || sc.icon >= stringsSize || !placed ||
+                sc.subtreeSize >= header->categoryCount - x ||
+                sc.firstMember > header->memberCount ||
+                sc.memberCount > header->memberCount - sc.firstMember)
+        {
+            valid = false;
+            break;
+        }
+        Category *c = new Category(std::string(strings + sc.name), false, 
+                noIcons, "/", false);
+        c->icon = strings + sc.icon;
+        c->depth = sc.depth;
+        c->nodisplay = sc.flags & SNAPSHOT_NODISPLAY;
+        if (sc.parent == SNAPSHOT_NO_PARENT) topCats.push_back(c);
+        else loadedCats[sc.parent]->registerSubcat(c);
+        loadedCats.push_back(c);
+        for (uint32_t y = sc.firstMember; y < sc.firstMember + sc.memberCount; y++)
+        {
+            if (members[y] >= loaded.size())
+            {
+                valid = false;
+                break;
+            }
+            c->registerEntry(loaded, members[y], true);
+        }
+    }
+    munmap((void*)data, size);
+
+    if (!valid)
+    {
+        //Subcategories are deleted with the top level categories they are in
+        for (unsigned int x = 0; x < topCats.size(); x++) delete topCats[x];
+        return false;
+    }
+    cats.insert(cats.end(), topCats.begin(), topCats.end());
+    entries = loaded;
+    return true;
+}
@@ -0,0 +1,92 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window 
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class Category;
+class EntryTable;
+
+/* A snapshot is laid out as the header followed by the entry table, the
+ * category table, the membership table and the string pool. Every table is
+ * made of 32 bit fields so the file can be mapped and checked without being
+ * parsed. The model is still rebuilt from the mapped tables when it is 
+ * loaded, as filtering and pagination change it. Strings
+ * are stored once each, nul terminated, and referenced by their offset into
+ * the pool. Categories are stored in pre-order: the subcategories of a 
+ * category are the subtreeSize categories following it, and the entries of a
+ * category are memberCount indices into the entry table, starting at 
+ * firstMember in the membership table. The entry table is the columns of an
+ * EntryTable side by side and the start of the pool is its string pool, so 
+ * entry strings are copied across without being looked at. Exec lines are 
+ * stored without the terminal command, which is added when the menu is 
+ * written */
+#define SNAPSHOT_MAGIC "MWMMODEL"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_NO_PARENT 0xffffffff
+
+#define SNAPSHOT_NODISPLAY 0x1
+#define SNAPSHOT_TERMINAL 0x2
+
+struct SnapshotHeader
+{   char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t entryCount;
+    uint32_t categoryCount;
+    uint32_t memberCount;
+    uint32_t stringsSize;
+};
+
+struct SnapshotEntry
+{   uint32_t filename;
+    uint32_t name;
+    uint32_t exec;
+    uint32_t icon;
+    uint32_t flags;
+};
+
+struct SnapshotCategory
+{   uint32_t name;
+    uint32_t icon;
+    uint32_t depth;
+    uint32_t flags;
+    uint32_t parent;
+    uint32_t subtreeSize;
+    uint32_t firstMember;
+    uint32_t memberCount;
+};
+
+class Snapshot
+{
+    public:
+        static bool save(const std::string& path, 
+                const std::vector<Category*>& cats, 
+                const EntryTable& entries);
+        static bool load(const std::string& path, std::vector<Category*>& cats,
+                EntryTable& entries);
+};
+
+#endif
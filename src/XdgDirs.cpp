@@ -0,0 +1,113 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include "XdgDirs.h"
+#include "DesktopFile.h"
+
+XdgDirs::XdgDirs(const std::string& homedir)
+{
+    std::vector<std::string> home = pathList("XDG_DATA_HOME", 
+            homedir + "/.local/share");
+    dataHome = home.empty() ? homedir + "/.local/share" : home[0];
+    dataDirs = pathList("XDG_DATA_DIRS", "/usr/local/share:/usr/share");
+    home = pathList("XDG_CONFIG_HOME", homedir + "/.config");
+    configHome = home.empty() ? homedir + "/.config" : home[0];
+    configDirs = pathList("XDG_CONFIG_DIRS", "/etc/xdg");
+}
+
+/* Split a colon separated list of directories, dropping relative paths and 
+ * trailing slashes */
+std::vector<std::string> XdgDirs::splitPaths(const std::string& value)
+{
+    std::vector<std::string> found = DesktopFile::getMultiValue(value, ':', '\0');
+    std::vector<std::string> dirs;
+    for (unsigned int x = 0; x < found.size(); x++)
+    {
+        std::string dir = found[x];
+        if (dir.empty() || dir[0] != '/') continue;
+        while (dir.size() > 1 && dir[dir.size() - 1] == '/') 
+            dir.erase(dir.size() - 1);
+        dirs.push_back(dir);
+    }
+    return dirs;
+}
+
+/* Return the directories listed in an environment variable, or the default 
+ * if the variable is unset or lists nothing usable */
+std::vector<std::string> XdgDirs::pathList(const char *variable, 
+        const std::string& fallback)
+{
+    const char *value = getenv(variable);
+    std::vector<std::string> dirs;
+    if (value != NULL) dirs = splitPaths(value);
+    if (dirs.empty()) dirs = splitPaths(fallback);
+    return dirs;
+}
+
+/* Return subdir under the user data directory and then under each system 
+ * data directory */
+std::vector<std::string> XdgDirs::dataPaths(const std::string& subdir)
+{
+    std::vector<std::string> paths;
+    paths.push_back(dataHome + "/" + subdir);
+    std::vector<std::string> system = systemDataPaths(subdir);
+    paths.insert(paths.end(), system.begin(), system.end());
+    return paths;
+}
+
+/* Return subdir under each system data directory */
+std::vector<std::string> XdgDirs::systemDataPaths(const std::string& subdir)
+{
+    std::vector<std::string> paths;
+    for (unsigned int x = 0; x < dataDirs.size(); x++)
+        paths.push_back(dataDirs[x] + "/" + subdir);
+    return paths;
+}
+
+/* Drop directories which don't exist, and directories which are the same 
+ * directory as an earlier one or lie inside it once symlinks are resolved. 
+ * Directories are walked recursively, so these would only be walked again. 
+ * The directories kept are returned as given, so paths found under them are 
+ * the paths the user knows */
+std::vector<std::string> XdgDirs::uniqueRoots(const std::vector<std::string>& dirs)
+{
+    std::vector<std::string> roots;
+    std::vector<std::string> resolved;
+    char buffer[PATH_MAX];
+    for (unsigned int x = 0; x < dirs.size(); x++)
+    {
+        if (realpath(dirs[x].c_str(), buffer) == NULL) continue;
+        std::string real = buffer;
+        bool walked = false;
+        for (unsigned int y = 0; y < resolved.size() && !walked; y++)
+        {
+            const std::string& root = resolved[y];
+            if (real == root || (real.compare(0, root.size(), root) == 0 && 
+                    (root == "/" || real[root.size()] == '/')))
+                walked = true;
+        }
+        if (walked) continue;
+        roots.push_back(dirs[x]);
+        resolved.push_back(real);
+    }
+    return roots;
+}
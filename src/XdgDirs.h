@@ -0,0 +1,52 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _XDG_DIRS_H_
+#define _XDG_DIRS_H_
+
+#include <string>
+#include <vector>
+
+/* The base directories from the XDG base directory specification, in order 
+ * of precedence. Unset or empty variables get the defaults given by the 
+ * specification and relative paths are ignored */
+class XdgDirs
+{
+    public:
+        XdgDirs(const std::string& homedir);
+
+        std::string dataHome;
+        std::vector<std::string> dataDirs;
+        std::string configHome;
+        std::vector<std::string> configDirs;
+
+        std::vector<std::string> dataPaths(const std::string& subdir);
+        std::vector<std::string> systemDataPaths(const std::string& subdir);
+
+        static std::vector<std::string> uniqueRoots(
+                const std::vector<std::string>& dirs);
+
+    private:
+        static std::vector<std::string> splitPaths(const std::string& value);
+        static std::vector<std::string> pathList(const char *variable, 
+                const std::string& fallback);
+};
+
+#endif
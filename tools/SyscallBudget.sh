@@ -0,0 +1,187 @@
+#!/bin/sh
+#
+# mwmmenu - a program to produce application menus for MWM and other window 
+# managers, based on freedesktop.org desktop entries.
+#
+# Copyright (C) 2015  Charles Bos
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+# Run mwmmenu over a generated XDG tree with the SyscallCount shim preloaded 
+# and check the calls made in each scenario against a budget. Run by make 
+# test. Most counters are system calls, but the shim can't see the calls 
+# glibc makes to itself, so "entries" counts the directory entries readdir
+# returns rather than getdents64 calls, and "flush" counts the fflush calls
+# through which the menu is written rather than the writes they make. If a
+# change needs more calls, raise the budget in the same commit and say why.
+# The same tree is then used to check that custom menus nested deeper than
+# --max-menu-depth are skipped, and that nested menus with directory files
+# of their own, as Wine writes them, are read.
+#
+# Usage: SyscallBudget.sh MWMMENU SHIM
+
+MWMMENU=$1
+SHIM=$2
+if [ ! -x "$MWMMENU" ] || [ ! -f "$SHIM" ]; then
+    echo "usage: $0 MWMMENU SHIM" >&2
+    exit 1
+fi
+case $MWMMENU in /*) ;; *) MWMMENU=$PWD/$MWMMENU ;; esac
+case $SHIM in /*) ;; *) SHIM=$PWD/$SHIM ;; esac
+
+ROOT=$(mktemp -d) || exit 1
+trap 'rm -rf "$ROOT"' EXIT
+
+# The tree: 300 user entries and 60 system ones (20 of which the user ones 
+# override), 100 icons, a custom category and a few programs on $PATH
+APPS=$ROOT/home/.local/share/applications
+SYSAPPS=$ROOT/usr/share/applications
+ICONS=$ROOT/usr/share/icons/hicolor/48x48/apps
+mkdir -p "$APPS" "$SYSAPPS" "$ICONS" "$ROOT/usr/share/pixmaps" \
+    "$ROOT/usr/share/desktop-directories" "$ROOT/etc/xdg/menus/applications-merged" \
+    "$ROOT/home/.config" "$ROOT/bin"
+CATEGORIES="Development Education Game Graphics AudioVideo Network Office Science Settings System Utility"
+entry()
+{
+    printf '[Desktop Entry]\nType=Application\nName=%s\nName[de]=%s DE\n' "$1" "$1"
+    printf 'Comment=Generated entry %s\nExec=%s %%U\nIcon=icon%s\n' "$1" "$2" "$3"
+    printf 'Categories=%s;\n' "$4"
+    printf '\n[Desktop Action New]\nName=New Window\nExec=%s --new\n' "$2"
+}
+n=0
+for cat in $CATEGORIES; do
+    i=0
+    while [ $i -lt 27 ]; do
+        n=$((n + 1))
+        entry "App $n" "prog$n" $((n % 100)) "$cat" > "$APPS/app$n.desktop"
+        i=$((i + 1))
+    done
+done
+while [ $n -lt 300 ]; do
+    n=$((n + 1))
+    entry "App $n" "prog$n" $((n % 100)) "Utility" > "$APPS/app$n.desktop"
+done
+n=280
+while [ $n -lt 340 ]; do
+    n=$((n + 1))
+    entry "System App $n" "sysprog$n" $((n % 100)) "Graphics" > "$SYSAPPS/app$n.desktop"
+done
+i=0
+while [ $i -lt 100 ]; do
+    : > "$ICONS/icon$i.png"
+    i=$((i + 1))
+done
+: > "$ROOT/usr/share/pixmaps/extra.xpm"
+printf '[Desktop Entry]\nName=Tools\nIcon=icon1\n' > "$ROOT/usr/share/desktop-directories/tools.directory"
+printf '<Menu>\n<Directory>tools.directory</Directory>\n<Include>\n<Filename>app1.desktop</Filename>\n</Include>\n</Menu>\n' \
+    > "$ROOT/etc/xdg/menus/applications-merged/tools.menu"
+for prog in prog1 prog2 prog3 sh; do
+    : > "$ROOT/bin/$prog"
+    chmod +x "$ROOT/bin/$prog"
+done
+
+COUNTS=$ROOT/counts
+FAILED=0
+echo "entries: directory entries read, not getdents64 calls"
+echo "flush: stdio flushes, not the writes they make"
+
+# Run mwmmenu with the given options and add up the counts of every process
+run()
+{
+    rm -f "$COUNTS"
+    env -i HOME="$ROOT/home" PATH="$ROOT/bin" \
+        XDG_DATA_HOME="$ROOT/home/.local/share" XDG_DATA_DIRS="$ROOT/usr/share" \
+        XDG_CONFIG_HOME="$ROOT/home/.config" XDG_CONFIG_DIRS="$ROOT/etc/xdg" \
+        XDG_CACHE_HOME="$ROOT/home/.cache" \
+        SYSCALL_COUNT_FILE="$COUNTS" LD_PRELOAD="$SHIM" \
+        "$MWMMENU" "$@" > "$ROOT/menu" 2> "$ROOT/errors" || 
+        { cat "$ROOT/errors" >&2; echo "mwmmenu $* failed" >&2; exit 1; }
+    [ -s "$ROOT/menu" ] || { echo "mwmmenu $* wrote no menu" >&2; exit 1; }
+}
+
+# Check the counts of the last run against "name=limit" budgets
+check()
+{
+    scenario=$1
+    shift
+    for budget in "$@"; do
+        name=${budget%%=*}
+        limit=${budget#*=}
+        count=$(awk -v name="$name" '{ for (i = 1; i < NF; i += 2) 
+            if ($i == name) total += $(i + 1) } END { print total + 0 }' "$COUNTS")
+        if [ "$count" -gt "$limit" ]; then
+            result="OVER BUDGET"
+            FAILED=1
+        else
+            result="ok"
+        fi
+        printf '%-6s %-9s %6d / %-6d %s\n' "$scenario" "$name" "$count" "$limit" "$result"
+    done
+}
+
+# A run with no cache, which lists every directory and reads every entry
+rm -rf "$ROOT/home/.cache"
+run --fvwm -i
+check cold open=360 stat=1220 opendir=10 entries=510 read=720 write=4 flush=420
+
+# The same run again, which takes the listings and entries from the cache
+run --fvwm -i
+check warm open=6 stat=370 opendir=0 entries=0 read=16 write=2 flush=420
+
+# An Openbox pipe menu for one category, as run by Openbox on opening it
+run --openbox-pipe -i --category Graphics
+check pipe open=6 stat=370 opendir=0 entries=0 read=16 write=2 flush=370
+
+# The custom category with submenus nested four levels deep, of which only 
+# the first two are kept
+{
+    printf '<Menu>\n<Directory>tools.directory</Directory>\n'
+    printf '<Include>\n<Filename>app1.desktop</Filename>\n</Include>\n'
+    for level in 1 2 3 4; do
+        printf '<Menu>\n<Name>Level %s</Name>\n' $level
+        printf '<Include>\n<Filename>app%s.desktop</Filename>\n</Include>\n' \
+            $((level + 1))
+    done
+    printf '</Menu>\n</Menu>\n</Menu>\n</Menu>\n</Menu>\n'
+} > "$ROOT/etc/xdg/menus/applications-merged/tools.menu"
+run --fvwm --max-menu-depth 2
+for menu in Tools "Level 1" "Level 2"; do
+    grep -q "^AddToMenu \"$menu\"" "$ROOT/menu" || 
+        { echo "nested menu $menu is missing"; FAILED=1; }
+done
+for menu in "Level 3" "Level 4"; do
+    grep -q "^AddToMenu \"$menu\"" "$ROOT/menu" && 
+        { echo "menu $menu is nested too deep but was kept"; FAILED=1; }
+done
+grep -q "skipping menus nested more than 2 levels deep" "$ROOT/errors" ||
+    { echo "menus nested too deep were skipped without a message"; FAILED=1; }
+
+# A menu written the way Wine writes them, on one line, with nested menus
+# which have directory files of their own. The last nested menu has no name
+# of its own or in its missing directory file, so it is skipped
+DIRS=$ROOT/usr/share/desktop-directories
+printf '[Desktop Entry]\nName=Wine\n' > "$DIRS/wine-wine.directory"
+printf '[Desktop Entry]\nName=Programs\nIcon=icon2\n' > "$DIRS/wine-programs.directory"
+printf '%s%s%s%s\n' '<Menu><Name>Applications</Name><Menu><Name>wine-wine</Name>' \
+    '<Directory>wine-wine.directory</Directory><Menu><Name>wine-Programs</Name>' \
+    '<Directory>wine-programs.directory</Directory><Include><Filename>app6.desktop' \
+    '</Filename></Include></Menu><Menu><Directory>missing.directory</Directory></Menu></Menu></Menu>' \
+    > "$ROOT/etc/xdg/menus/applications-merged/wine.menu"
+run --fvwm -i
+grep -q '^+ "wine-Programs.*" Popup "wine-Programs"' "$ROOT/menu" ||
+    { echo "nested Wine menu is missing"; FAILED=1; }
+grep -q "skipping a menu without a name" "$ROOT/errors" ||
+    { echo "a nested menu without a name was not skipped"; FAILED=1; }
+
+exit $FAILED
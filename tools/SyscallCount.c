@@ -0,0 +1,273 @@
+/*
+ * mwmmenu - a program to produce application menus for MWM and other window
+ * managers, based on freedesktop.org desktop entries.
+ *
+ * Copyright (C) 2015  Charles Bos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* An LD_PRELOAD shim which counts the file system calls a program makes and
+ * writes the counts out when it exits. Used by SyscallBudget.sh to keep the
+ * number of calls mwmmenu makes from creeping up. Build it with make test.
+ *
+ * Calls glibc makes to itself aren't seen, so two of the counters count 
+ * library calls rather than system calls. readdir fetches directory entries
+ * with an internal getdents64, which can't be caught, so "entries" is the 
+ * number of entries readdir hands back, not the number of getdents64 calls.
+ * std::cout writes through stdio, whose writes are internal too, so "flush" 
+ * is the number of fflush calls, which std::endl makes. "write" is only the
+ * write and writev calls made directly. Each process appends one line to 
+ * $SYSCALL_COUNT_FILE, or to standard error if it isn't set:
+ *
+ *   open N stat N opendir N entries N read N write N flush N */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+enum Counter
+{
+    countOpen = 0,
+    countStat,
+    countOpendir,
+    countEntries,
+    countRead,
+    countWrite,
+    countFlush,
+    numCounters
+};
+
+static const char *counterNames[numCounters] = {"open", "stat", "opendir", 
+    "entries", "read", "write", "flush"};
+static unsigned long counts[numCounters];
+
+#define COUNT(X) __atomic_add_fetch(&counts[X], 1, __ATOMIC_RELAXED)
+
+/* Look up the next definition of a function, i.e. the one in libc */
+#define REAL(NAME) \
+    static __typeof__(&NAME) real = NULL; \
+    if (real == NULL) real = (__typeof__(&NAME))dlsym(RTLD_NEXT, #NAME)
+
+/* open and openat only take a mode when creating a file */
+#define OPEN_MODE(FLAGS, MODE) \
+    mode_t MODE = 0; \
+    if ((FLAGS) & (O_CREAT | O_TMPFILE)) \
+    { \
+        va_list args; \
+        va_start(args, FLAGS); \
+        MODE = va_arg(args, mode_t); \
+        va_end(args); \
+    }
+
+int open(const char *path, int flags, ...)
+{
+    REAL(open);
+    OPEN_MODE(flags, mode);
+    COUNT(countOpen);
+    return real(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    REAL(open64);
+    OPEN_MODE(flags, mode);
+    COUNT(countOpen);
+    return real(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+    REAL(openat);
+    OPEN_MODE(flags, mode);
+    COUNT(countOpen);
+    return real(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+    REAL(openat64);
+    OPEN_MODE(flags, mode);
+    COUNT(countOpen);
+    return real(dirfd, path, flags, mode);
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    REAL(fopen);
+    COUNT(countOpen);
+    return real(path, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode)
+{
+    REAL(fopen64);
+    COUNT(countOpen);
+    return real(path, mode);
+}
+
+int stat(const char *path, struct stat *buf)
+{
+    REAL(stat);
+    COUNT(countStat);
+    return real(path, buf);
+}
+
+int stat64(const char *path, struct stat64 *buf)
+{
+    REAL(stat64);
+    COUNT(countStat);
+    return real(path, buf);
+}
+
+int lstat(const char *path, struct stat *buf)
+{
+    REAL(lstat);
+    COUNT(countStat);
+    return real(path, buf);
+}
+
+int lstat64(const char *path, struct stat64 *buf)
+{
+    REAL(lstat64);
+    COUNT(countStat);
+    return real(path, buf);
+}
+
+int fstat(int fd, struct stat *buf)
+{
+    REAL(fstat);
+    COUNT(countStat);
+    return real(fd, buf);
+}
+
+int fstat64(int fd, struct stat64 *buf)
+{
+    REAL(fstat64);
+    COUNT(countStat);
+    return real(fd, buf);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *buf, int flags)
+{
+    REAL(fstatat);
+    COUNT(countStat);
+    return real(dirfd, path, buf, flags);
+}
+
+int fstatat64(int dirfd, const char *path, struct stat64 *buf, int flags)
+{
+    REAL(fstatat64);
+    COUNT(countStat);
+    return real(dirfd, path, buf, flags);
+}
+
+int statx(int dirfd, const char *path, int flags, unsigned int mask, 
+        struct statx *buf)
+{
+    REAL(statx);
+    COUNT(countStat);
+    return real(dirfd, path, flags, mask, buf);
+}
+
+DIR *opendir(const char *path)
+{
+    REAL(opendir);
+    COUNT(countOpendir);
+    return real(path);
+}
+
+DIR *fdopendir(int fd)
+{
+    REAL(fdopendir);
+    COUNT(countOpendir);
+    return real(fd);
+}
+
+struct dirent *readdir(DIR *dir)
+{
+    REAL(readdir);
+    struct dirent *entry = real(dir);
+    if (entry != NULL) COUNT(countEntries);
+    return entry;
+}
+
+struct dirent64 *readdir64(DIR *dir)
+{
+    REAL(readdir64);
+    struct dirent64 *entry = real(dir);
+    if (entry != NULL) COUNT(countEntries);
+    return entry;
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    REAL(read);
+    COUNT(countRead);
+    return real(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    REAL(write);
+    COUNT(countWrite);
+    return real(fd, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    REAL(writev);
+    COUNT(countWrite);
+    return real(fd, iov, iovcnt);
+}
+
+int fflush(FILE *stream)
+{
+    REAL(fflush);
+    COUNT(countFlush);
+    return real(stream);
+}
+
+/* Write the counts when the program exits. The line is written with the 
+ * real write and a single call, so it isn't counted and lines from several
+ * processes don't mix */
+__attribute__((destructor)) static void report(void)
+{
+    char line[256];
+    int length = 0;
+    for (int x = 0; x < numCounters; x++)
+    {
+        length += snprintf(line + length, sizeof(line) - length, "%s%s %lu", 
+                x == 0 ? "" : " ", counterNames[x], 
+                __atomic_load_n(&counts[x], __ATOMIC_RELAXED));
+    }
+    length += snprintf(line + length, sizeof(line) - length, "\n");
+
+    __typeof__(&write) realWrite = (__typeof__(&write))dlsym(RTLD_NEXT, "write");
+    __typeof__(&open) realOpen = (__typeof__(&open))dlsym(RTLD_NEXT, "open");
+    const char *path = getenv("SYSCALL_COUNT_FILE");
+    int fd = 2;
+    if (path != NULL) fd = realOpen(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return;
+    realWrite(fd, line, length);
+    if (fd != 2) close(fd);
+}